@@ -21,11 +21,19 @@ N5110::N5110(PinName pwrPin, PinName scePin, PinName rstPin, PinName dcPin, PinN
     rst = new DigitalOut(rstPin);
     dc = new DigitalOut(dcPin);
 
+    busy = 0;
+    refreshCallback = 0;
+    invalidate();  // contents of the display RAM are unknown until the first refresh
+
 }
 
 // initialise function - powers up and sends the initialisation commands
 void N5110::init()
 {
+#if DEVICE_SPI_ASYNCH
+    spi->abort_transfer();  // a frame left part sent is dropped, the RAM is cleared below
+#endif
+    busy = 0;
     turnOn();     // power up
     wait_ms(10);  // small delay seems to prevent spurious pixels during mbed reset
     reset();      // reset LCD - must be done within 100 ms
@@ -51,6 +59,7 @@ void N5110::init()
 // sets normal video mode (black on white)
 void N5110::normalMode()
 {
+    waitForRefresh();  // can't send commands in the middle of a frame
     sendCommand(CMD_DC_NORMAL_MODE);
 
 }
@@ -58,6 +67,7 @@ void N5110::normalMode()
 // sets normal video mode (white on black)
 void N5110::inverseMode()
 {
+    waitForRefresh();
     sendCommand(CMD_DC_INVERT_VIDEO);
 }
 
@@ -111,6 +121,9 @@ void N5110::initSPI()
 {
     spi->format(8,1);    // 8 bits, Mode 1 - polarity 0, phase 1 - base value of clock is 0, data captured on falling edge/propagated on rising edge
     spi->frequency(4000000);  // maximum of screen is 4 MHz
+#if DEVICE_SPI_ASYNCH
+    spi->set_dma_usage(DMA_USAGE_ALWAYS);  // frames are sent by DMA in refreshAsync()
+#endif
 }
 
 // send a command to the display
@@ -138,12 +151,15 @@ void N5110::sendData(unsigned char data)
 void N5110::clearRAM()
 {
     int i;
+    waitForRefresh();
     sce->write(0);  //set CE low to begin frame
     for(i = 0; i < WIDTH * HEIGHT; i++) { // 48 x 84 bits = 504 bytes
         spi->write(0x00);  // send 0's
     }
     sce->write(1); // set CE high to end frame
 
+    invalidate();  // the display no longer matches the buffer
+
 }
 
 // function to set the XY address in RAM for subsequenct data write
@@ -162,7 +178,11 @@ void N5110::setPixel(int x, int y)
 {
     if (x>=0 && x<WIDTH && y>=0 && y<HEIGHT) {  // check within range
         // calculate bank and shift 1 to required position in the data byte
-        buffer[x][y/8] |= (1 << y%8);
+        unsigned char data = buffer[y/8][x] | (1 << y%8);
+        if (data != buffer[y/8][x]) {  // only pixels that change need sending to the display
+            buffer[y/8][x] = data;
+            markDirty(x,y/8);
+        }
     }
 }
 
@@ -170,7 +190,11 @@ void N5110::clearPixel(int x, int y)
 {
     if (x>=0 && x<WIDTH && y>=0 && y<HEIGHT) {  // check within range
         // calculate bank and shift 1 to required position (using bit clear)
-        buffer[x][y/8] &= ~(1 << y%8);
+        unsigned char data = buffer[y/8][x] & ~(1 << y%8);
+        if (data != buffer[y/8][x]) {
+            buffer[y/8][x] = data;
+            markDirty(x,y/8);
+        }
     }
 }
 
@@ -178,48 +202,180 @@ int N5110::getPixel(int x, int y)
 {
     if (x>=0 && x<WIDTH && y>=0 && y<HEIGHT) {  // check within range
         // return relevant bank and mask required bit
-        return (int) buffer[x][y/8] & (1 << y%8);
+        return (int) buffer[y/8][x] & (1 << y%8);
         // note this does not necessarily return 1 - a non-zero number represents a pixel
     } else {
         return 0;
     }
 }
 
+// marks a byte of the buffer as changed so that it is sent by the next refresh
+// the bytes are numbered in the order they are written to the display RAM in horizontal addressing mode
+void N5110::markDirty(int x, int bank)
+{
+    int n = bank*WIDTH + x;
+    dirty[n >> 5] |= 1U << (n & 31);
+}
+
+// function to mark the whole buffer as changed
+void N5110::invalidate()
+{
+    for (int i = 0; i < DIRTY_WORDS; i++) {
+        dirty[i] = 0xFFFFFFFF;
+    }
+}
+
+// finds the next run of changed bytes starting at or after byte n and returns its start (-1 if there are none)
+// runs separated by REFRESH_GAP unchanged bytes or fewer are joined as it is cheaper to resend those bytes
+// than to set the address again
+int N5110::nextDirtyRun(const unsigned int *bits, int n, int *length)
+{
+    while (n < WIDTH*BANKS && !(bits[n >> 5] & (1U << (n & 31)))) {
+        if (bits[n >> 5] == 0) {
+            n = (n | 31) + 1;  // skip the rest of an unchanged word
+        } else {
+            n++;
+        }
+    }
+    if (n >= WIDTH*BANKS) {
+        return -1;
+    }
+
+    int start = n;
+    int end = n;
+    for (n = start + 1; n < WIDTH*BANKS && n - end <= REFRESH_GAP; n++) {
+        if (bits[n >> 5] & (1U << (n & 31))) {
+            end = n;
+        }
+    }
+    *length = end - start + 1;
+    return start;
+}
+
 // function to refresh the display
 void N5110::refresh()
 {
-    int i,j;
+    refreshAsync();
+    waitForRefresh();
+}
 
-    setXYAddress(0,0);  // important to set address back to 0,0 before refreshing display
-    // address auto increments after printing string, so buffer[0][0] will not coincide
-    // with top-left pixel after priting string
+// function to start refreshing the display
+void N5110::refreshAsync()
+{
+    int n,length;
+    int cost = 0;
 
-    sce->write(0);  //set CE low to begin frame
+    waitForRefresh();  // the frame can't be changed while it is being sent
+
+    // each run costs the two address command bytes plus its data
+    for (n = nextDirtyRun(dirty,0,&length); n >= 0; n = nextDirtyRun(dirty,n + length,&length)) {
+        cost += 2 + length;
+    }
+    if (cost >= 2 + WIDTH*BANKS) {  // cheaper to send the whole frame
+        invalidate();
+    }
+
+    // copy the changed bytes into the frame so that the buffer can be drawn on while they are sent
+    // the buffer is in the same order as the frame, so each run is one contiguous copy from the bytes of
+    // the whole buffer (a run can cross banks, which indexing one bank's row can't)
+    const unsigned char *bytes = (const unsigned char *)words;
+    for (n = nextDirtyRun(dirty,0,&length); n >= 0; n = nextDirtyRun(dirty,n + length,&length)) {
+        memcpy(&frame[n],&bytes[n],length);
+    }
+    for (n = 0; n < DIRTY_WORDS; n++) {
+        sending[n] = dirty[n];
+        dirty[n] = 0;
+    }
 
-    for(j = 0; j < BANKS; j++) {  // be careful to use correct order (j,i) for horizontal addressing
-        for(i = 0; i < WIDTH; i++) {
-            spi->write(buffer[i][j]);  // send buffer
+    busy = 1;
+    sendRuns(0);
+}
+
+// sends the runs of the frame at or after byte n. With asynchronous SPI only the first run's address is
+// started, and the SPI interrupt carries on from there without waiting for anything
+void N5110::sendRuns(int n)
+{
+    int length;
+
+    // address auto increments in horizontal addressing mode (and wraps to the next bank), so each run
+    // only needs its start address setting
+    while ((n = nextDirtyRun(sending,n,&length)) >= 0) {
+#if DEVICE_SPI_ASYNCH
+        // the two address commands go as a transfer of their own, as the blocking writes of
+        // setXYAddress() can't be made from the interrupt
+        runStart = n;
+        runLength = length;
+        address[0] = 0x80 | (n % WIDTH);
+        address[1] = 0x40 | (n / WIDTH);
+        dc->write(0);   // set DC low for the commands
+        sce->write(0);  // set CE low to begin frame
+        spi->transfer(address,2,(unsigned char *)NULL,0,event_callback_t(this,&N5110::addressSent));
+        return;
+#else
+        setXYAddress(n % WIDTH,n / WIDTH);
+
+        sce->write(0);  //set CE low to begin frame
+        for (int i = n; i < n + length; i++) {
+            spi->write(frame[i]);  // send frame
         }
+        sce->write(1); // set CE high to end frame
+        n += length;
+#endif
+    }
+
+    busy = 0;
+    if (refreshCallback) {
+        refreshCallback();
     }
+}
+
+#if DEVICE_SPI_ASYNCH
+// called from the SPI interrupt when a run's address has been sent, CE stays low for its data
+void N5110::addressSent(int event)
+{
+    dc->write(1);  // back to data
+    spi->transfer(&frame[runStart],runLength,(unsigned char *)NULL,0,event_callback_t(this,&N5110::transferComplete));
+}
+
+// called from the SPI interrupt when a run has been sent
+void N5110::transferComplete(int event)
+{
     sce->write(1); // set CE high to end frame
+    sendRuns(runStart + runLength);
+}
+#endif
 
+// function to wait for the frame being sent to reach the display
+void N5110::waitForRefresh()
+{
+    __disable_irq();  // busy is tested with interrupts masked, or the SPI interrupt could clear it just before the WFI
+    while (busy) {
+        __WFI();  // woken by the SPI interrupt even while it is masked, it runs once they are enabled
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+}
+
+// function to set the refresh callback
+void N5110::attachRefresh(void (*fptr)(void))
+{
+    refreshCallback = fptr;
 }
 
 // fills the buffer with random bytes.  Can be used to test the display.
 // The rand() function isn't seeded so it probably creates the same pattern everytime
 void N5110::randomiseBuffer()
 {
-    int i,j;
-    for(j = 0; j < BANKS; j++) {  // be careful to use correct order (j,i) for horizontal addressing
-        for(i = 0; i < WIDTH; i++) {
-            buffer[i][j] = rand()%256;  // generate random byte
-        }
+    for (int i = 0; i < BUFFER_WORDS; i++) {
+        words[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();  // rand() only gives 31 random bits, shifted unsigned so none overflow
     }
+    invalidate();
 
 }
 
 // function to print 5x7 font
-void N5110::printChar(char c,int x,int y)
+void N5110::printChar(char c,int x,int y,int when)
 {
     if (y>=0 && y<BANKS) {  // check if printing in range of y banks
 
@@ -227,16 +383,22 @@ void N5110::printChar(char c,int x,int y)
             int pixel_x = x+i;
             if (pixel_x > WIDTH-1)  // ensure pixel isn't outside the buffer size (0 - 83)
                 break;
-            buffer[pixel_x][y] = font5x7[(c - 32)*5 + i];
+            unsigned char data = font5x7[(c - 32)*5 + i];
             // array is offset by 32 relative to ASCII, each character is 5 pixels wide
+            if (data != buffer[y][pixel_x]) {
+                buffer[y][pixel_x] = data;
+                markDirty(pixel_x,y);
+            }
         }
 
-        refresh();  // this sends the buffer to the display and sets address (cursor) back to 0,0
+        if (when == TEXT_IMMEDIATE) {
+            refresh();  // this sends the buffer to the display and sets address (cursor) back to 0,0
+        }
     }
 }
 
 // function to print string at specified position
-void N5110::printString(const char * str,int x,int y)
+void N5110::printString(const char * str,int x,int y,int when)
 {
     if (y>=0 && y<BANKS) {  // check if printing in range of y banks
 
@@ -250,7 +412,11 @@ void N5110::printString(const char * str,int x,int y)
                 int pixel_x = x+i+n*6;
                 if (pixel_x > WIDTH-1) // ensure pixel isn't outside the buffer size (0 - 83)
                     break;
-                buffer[pixel_x][y] = font5x7[(*str - 32)*5 + i];
+                unsigned char data = font5x7[(*str - 32)*5 + i];
+                if (data != buffer[y][pixel_x]) {  // reprinting the same text doesn't need sending again
+                    buffer[y][pixel_x] = data;
+                    markDirty(pixel_x,y);
+                }
             }
 
             str++;  // go to next character in string
@@ -259,7 +425,9 @@ void N5110::printString(const char * str,int x,int y)
 
         }
 
-        refresh();  // this sends the buffer to the display and sets address (cursor) back to 0,0
+        if (when == TEXT_IMMEDIATE) {
+            refresh();  // this sends the buffer to the display and sets address (cursor) back to 0,0
+        }
     }
 }
 
@@ -273,14 +441,217 @@ void N5110::clear()
 // function to clear the buffer
 void N5110::clearBuffer()
 {
-    int i,j;
-    for (i=0; i<WIDTH; i++) {  // loop through the banks and set the buffer to 0
-        for (j=0; j<BANKS; j++) {
-            buffer[i][j]=0;
+    fill(0x00);
+}
+
+// sets each of length bytes of the buffer, starting at byte n, to (byte & keep) | set
+// bytes are done a word at a time between the first and last word boundaries in the range
+// only the words (or bytes) that change are marked dirty
+void N5110::modifyBytes(int n, int length, unsigned char keep, unsigned char set)
+{
+    unsigned char *bytes = (unsigned char *)words;  // the whole buffer, as n can be in any bank
+    int end = n + length;
+
+    for (; n < end && (n & 3); n++) {  // bytes before the first word boundary
+        unsigned char data = (bytes[n] & keep) | set;
+        if (data != bytes[n]) {
+            bytes[n] = data;
+            dirty[n >> 5] |= 1U << (n & 31);
+        }
+    }
+
+    uint32_t keep4 = keep * 0x01010101U;  // repeat the masks in each byte of a word
+    uint32_t set4 = set * 0x01010101U;
+    for (; n + 4 <= end; n += 4) {
+        uint32_t data = (words[n >> 2] & keep4) | set4;
+        if (data != words[n >> 2]) {
+            words[n >> 2] = data;
+            dirty[n >> 5] |= 0xFU << (n & 31);  // a word never straddles two dirty words
+        }
+    }
+
+    for (; n < end; n++) {  // bytes after the last word boundary
+        unsigned char data = (bytes[n] & keep) | set;
+        if (data != bytes[n]) {
+            bytes[n] = data;
+            dirty[n >> 5] |= 1U << (n & 31);
+        }
+    }
+}
+
+// copies a whole frame into the buffer, marking only the bytes that differ
+void N5110::setBuffer(const unsigned char *bytes)
+{
+    unsigned char *current = (unsigned char *)words;
+    for (int n = 0; n < BANKS*WIDTH; n++) {
+        if (current[n] != bytes[n]) {
+            current[n] = bytes[n];
+            markDirtyBytes(n,1);
+        }
+    }
+}
+
+// marks length bytes of the buffer, starting at byte n, as changed
+void N5110::markDirtyBytes(int n, int length)
+{
+    for (int end = n + length; n < end; n++) {
+        if ((n & 31) == 0 && n + 32 <= end) {
+            dirty[n >> 5] = 0xFFFFFFFF;  // whole dirty word at once
+            n += 31;
+        } else {
+            dirty[n >> 5] |= 1U << (n & 31);
+        }
+    }
+}
+
+// function to draw a sprite
+void N5110::drawSprite(int x,int y,const Sprite *sprite,int mode)
+{
+    x -= sprite->originX;  // top-left of the sprite
+    y -= sprite->originY;
+    if (y >= HEIGHT || y + sprite->height <= 0) {
+        return;
+    }
+
+    // clip the columns to the screen
+    int first = (x < 0) ? -x : 0;
+    int last = (x + sprite->width > WIDTH) ? WIDTH - x : sprite->width;
+
+    int top = y >> 3;   // bank holding the top row of the sprite (rounded down, so -1 if above the screen)
+    int shift = y & 7;  // row within that bank
+
+    for (int i = first; i < last; i++) {
+        uint32_t bits = (uint32_t) sprite->columns[i] << shift;  // the column across the banks it falls in
+        int column = x + i;
+
+        for (int bank = top; bits && bank < BANKS; bank++, bits >>= 8) {
+            unsigned char mask = bits & 0xFF;
+            if (bank < 0 || !mask) {
+                continue;
+            }
+            unsigned char data;
+            if (mode == SPRITE_SET) {
+                data = buffer[bank][column] | mask;
+            } else if (mode == SPRITE_XOR) {
+                data = buffer[bank][column] ^ mask;
+            } else {
+                data = buffer[bank][column] & ~mask;
+            }
+            if (data != buffer[bank][column]) {
+                buffer[bank][column] = data;
+                markDirty(column,bank);
+            }
         }
     }
 }
 
+// function to fill the buffer with a byte pattern
+void N5110::fill(unsigned char pattern)
+{
+    modifyBytes(0,WIDTH*BANKS,0x00,pattern);
+}
+
+// function to clear a rectangle of pixels
+void N5110::clearRegion(int x0,int y0,int width,int height)
+{
+    // clip to the screen
+    if (x0 < 0) {
+        width += x0;
+        x0 = 0;
+    }
+    if (y0 < 0) {
+        height += y0;
+        y0 = 0;
+    }
+    if (x0 + width > WIDTH) {
+        width = WIDTH - x0;
+    }
+    if (y0 + height > HEIGHT) {
+        height = HEIGHT - y0;
+    }
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // clear the rows of the rectangle that fall in each bank, along the whole width in one go
+    for (int bank = y0/8; bank <= (y0 + height - 1)/8; bank++) {
+        int top = (y0 > bank*8) ? y0 - bank*8 : 0;
+        int bottom = (y0 + height < bank*8 + 8) ? y0 + height - bank*8 : 8;
+        unsigned char mask = (0xFF << top) & (0xFF >> (8 - bottom));
+        modifyBytes(bank*WIDTH + x0,width,~mask,0x00);
+    }
+}
+
+// function to copy a rectangle of whole banks to another position in the buffer
+void N5110::copyRegion(int x0,int bank0,int width,int banks,int x1,int bank1)
+{
+    // clip the source and destination to the screen
+    if (x0 < 0) {
+        width += x0;
+        x1 -= x0;
+        x0 = 0;
+    }
+    if (x1 < 0) {
+        width += x1;
+        x0 -= x1;
+        x1 = 0;
+    }
+    if (bank0 < 0) {
+        banks += bank0;
+        bank1 -= bank0;
+        bank0 = 0;
+    }
+    if (bank1 < 0) {
+        banks += bank1;
+        bank0 -= bank1;
+        bank1 = 0;
+    }
+    if (x0 + width > WIDTH) {
+        width = WIDTH - x0;
+    }
+    if (x1 + width > WIDTH) {
+        width = WIDTH - x1;
+    }
+    if (bank0 + banks > BANKS) {
+        banks = BANKS - bank0;
+    }
+    if (bank1 + banks > BANKS) {
+        banks = BANKS - bank1;
+    }
+    if (width <= 0 || banks <= 0) {
+        return;
+    }
+
+    // copy bank by bank in the order that doesn't overwrite banks still to be copied
+    // memmove() handles overlap within a bank and copies a word at a time where aligned
+    for (int i = 0; i < banks; i++) {
+        int j = (bank1 > bank0) ? banks - 1 - i : i;
+        memmove(&buffer[bank1 + j][x1],&buffer[bank0 + j][x0],width);
+        markDirtyBytes((bank1 + j)*WIDTH + x1,width);
+    }
+}
+
+// function to scroll a bank horizontally
+void N5110::scrollBank(int bank,int dx)
+{
+    if (bank < 0 || bank >= BANKS || dx == 0) {
+        return;
+    }
+    if (dx >= WIDTH || dx <= -WIDTH) {
+        modifyBytes(bank*WIDTH,WIDTH,0x00,0x00);
+        return;
+    }
+
+    if (dx > 0) {  // right - columns move to higher x, new columns at the left are cleared
+        memmove(&buffer[bank][dx],&buffer[bank][0],WIDTH - dx);
+        memset(&buffer[bank][0],0,dx);
+    } else {       // left
+        memmove(&buffer[bank][0],&buffer[bank][-dx],WIDTH + dx);
+        memset(&buffer[bank][WIDTH + dx],0,-dx);
+    }
+    markDirtyBytes(bank*WIDTH,WIDTH);
+}
+
 // function to plot array on display
 void N5110::plotArray(float array[])
 {
@@ -37,8 +37,41 @@
 #define HEIGHT 48
 #define BANKS 6
 
+// refresh() merges runs of changed bytes separated by this many unchanged bytes or fewer,
+// since re-addressing the display RAM costs two command bytes
+#define REFRESH_GAP 2
+#define DIRTY_WORDS ((WIDTH*BANKS + 31)/32)
+#define BUFFER_WORDS (WIDTH*BANKS/4)
+
+// modes for drawSprite()
+#define SPRITE_CLEAR 0
+#define SPRITE_SET 1
+#define SPRITE_XOR 2
+#define SPRITE_MAX_HEIGHT 16
+
+// when printString() and printChar() send the text to the display
+#define TEXT_DEFERRED 0   // at the next refresh
+#define TEXT_IMMEDIATE 1  // straight away, by refreshing the whole display
+
 #include "mbed.h"
 
+/**
+Sprite packed into columns for drawSprite()
+@brief Each column is a bitmask of its pixels, with bit 0 at the top of the sprite, in the same way as a byte of a bank.
+@param columns - bitmask for each column, left to right
+@param width - number of columns
+@param height - number of rows (up to SPRITE_MAX_HEIGHT)
+@param originX - column of the sprite's reference point, which is drawn at the given coordinates
+@param originY - row of the sprite's reference point
+*/
+struct Sprite {
+    const uint16_t *columns;
+    int width;
+    int height;
+    int originX;
+    int originY;
+};
+
 /**
 @brief Library for interfacing with Nokia 5110 LCD display (https://www.sparkfun.com/products/10168) using the hardware SPI on the mbed.
 @brief The display is powered from a GPIO pin meaning it can be controlled via software.  The LED backlight is also software-controllable (via PWM pin).
@@ -75,6 +108,7 @@ int main()
         lcd.setBrightness(0.5); // put LED backlight on 50%
 
         // can directly print strings at specified co-ordinates
+        // text is drawn into the buffer and sent at the next refresh
         lcd.printString("Hello, World!",0,0);
 
         char buffer[14];  // each character is 6 pixels wide, screen is 84 pixels (84/6 = 14)
@@ -179,6 +213,7 @@ public:
     *
     *   Powers up the display and turns on backlight (50% brightness default).
     *   Sets the display up in horizontal addressing mode and with normal video mode.
+    *   A refresh still being sent is abandoned, so init() can start the display again at any time.
     */
     void init();
 
@@ -214,20 +249,24 @@ public:
 
     /** Print String
     *
-    *   Prints a string of characters to the display. String is cut-off after the 83rd pixel.
+    *   Prints a string of characters to the buffer. String is cut-off after the 83rd pixel.
+    *   By default the string is sent to the display with everything else at the next refresh.
     *   @param x - the column number (0 to 83)
     *   @param y - the row number (0 to 5) - the display is split into 6 banks - each bank can be considered a row
+    *   @param when - TEXT_DEFERRED (default) or TEXT_IMMEDIATE to refresh the display before returning
     */
-    void printString(const char * str,int x,int y);
+    void printString(const char * str,int x,int y,int when = TEXT_DEFERRED);
 
     /** Print Character
     *
-    *   Sends a character to the display.  Printed at the specified location. Character is cut-off after the 83rd pixel.
+    *   Prints a character to the buffer at the specified location. Character is cut-off after the 83rd pixel.
+    *   By default the character is sent to the display with everything else at the next refresh.
     *   @param  c - the character to print. Can print ASCII as so printChar('C').
     *   @param x - the column number (0 to 83)
     *   @param y - the row number (0 to 5) - the display is split into 6 banks - each bank can be considered a row
+    *   @param when - TEXT_DEFERRED (default) or TEXT_IMMEDIATE to refresh the display before returning
     */
-    void printChar(char c,int x,int y);
+    void printChar(char c,int x,int y,int when = TEXT_DEFERRED);
 
     /** Set a Pixel
     *
@@ -261,9 +300,50 @@ public:
     /** Refresh display
     *
     *   This functions refreshes the display to reflect the current data in the buffer.
+    *   Only the bytes that have changed since the last refresh are sent, unless sending
+    *   the whole frame would be cheaper. Returns once the display has been updated.
     */
     void refresh();
 
+    /** Refresh display without waiting
+    *
+    *   Copies the changed bytes of the buffer into the frame being sent and starts sending it.
+    *   The buffer can be drawn on straight away, changes made during the transfer appear
+    *   at the next refresh. Where the target supports asynchronous SPI (DEVICE_SPI_ASYNCH)
+    *   the transfer is done by DMA and this returns immediately, otherwise it blocks as refresh() does.
+    *   If a previous transfer is still in progress, this waits for it first.
+    */
+    void refreshAsync();
+
+    /** Wait for refresh
+    *
+    *   Waits until the frame started by the last call to refreshAsync() has been sent to the display.
+    */
+    void waitForRefresh();
+
+    /** Attach refresh callback
+    *
+    *   Sets a function to be called each time a frame has been sent to the display.
+    *   With asynchronous SPI it is called from the SPI interrupt.
+    *   @param fptr - function to call, or 0 for none
+    */
+    void attachRefresh(void (*fptr)(void));
+
+    /** Invalidate display
+    *
+    *   Marks the whole buffer as changed so that the next call to refresh() sends a full frame.
+    *   Must be called after writing to the buffer directly rather than through the member functions.
+    */
+    void invalidate();
+
+    /** Set Buffer
+    *
+    *   Copies a whole frame into the buffer, in the order of the buffer's bytes, bank by bank.
+    *   Only the bytes that differ are marked as changed, so the next refresh sends just those.
+    *   @param bytes - the frame, BANKS*WIDTH bytes
+    */
+    void setBuffer(const unsigned char *bytes);
+
     /** Randomise buffer
     *
     *   This function fills the buffer with random data.  Can be used to test the display.
@@ -314,6 +394,57 @@ public:
     */
     void drawRect(int x0,int y0,int width,int height,int fill);
 
+    /** Draw Sprite
+    *
+    *   This function draws a sprite a column at a time. Each column is shifted into place and
+    *   combined with the (up to three) bytes of the banks it falls in. The sprite is clipped to the screen.
+    *   @param  x - x-coordinate of the sprite's reference point
+    *   @param  y - y-coordinate of the sprite's reference point
+    *   @param  sprite - the packed sprite
+    *   @param  mode - SPRITE_CLEAR clears the sprite's pixels, SPRITE_SET sets them and SPRITE_XOR inverts them
+    */
+    void drawSprite(int x,int y,const Sprite *sprite,int mode);
+
+    /** Fill
+    *
+    *   This function sets every byte of the buffer to a pattern, a word at a time.
+    *   Each byte is a column of 8 pixels in a bank, with the least significant bit at the top.
+    *   @param  pattern - byte written to each column of each bank (0x00 clears the screen, 0xFF sets it)
+    */
+    void fill(unsigned char pattern);
+
+    /** Clear Region
+    *
+    *   This function clears a rectangle of pixels. The rows of the rectangle within each bank
+    *   are cleared along its whole width a word at a time. The rectangle is clipped to the screen.
+    *   @param  x0 - x-coordinate of origin (top-left)
+    *   @param  y0 - y-coordinate of origin (top-left)
+    *   @param  width - width of rectangle in pixels
+    *   @param  height - height of rectangle in pixels
+    */
+    void clearRegion(int x0,int y0,int width,int height);
+
+    /** Copy Region
+    *
+    *   This function copies a rectangle of whole banks to another position in the buffer.
+    *   The source and destination may overlap. The rectangle is clipped to the screen.
+    *   @param  x0 - x-coordinate of the source (top-left)
+    *   @param  bank0 - first bank of the source (0 to 5)
+    *   @param  width - width of rectangle in pixels
+    *   @param  banks - height of rectangle in banks
+    *   @param  x1 - x-coordinate of the destination (top-left)
+    *   @param  bank1 - first bank of the destination (0 to 5)
+    */
+    void copyRegion(int x0,int bank0,int width,int banks,int x1,int bank1);
+
+    /** Scroll Bank
+    *
+    *   This function moves the columns of a bank sideways. Columns scrolled in are cleared.
+    *   @param  bank - the bank to scroll (0 to 5)
+    *   @param  dx - number of pixels to move, positive to the right and negative to the left
+    */
+    void scrollBank(int bank,int dx);
+
 
 private:
 
@@ -325,9 +456,23 @@ private:
     void clearBuffer();
     void sendCommand(unsigned char command);
     void sendData(unsigned char data);
+    void markDirty(int x, int bank);
+    void markDirtyBytes(int n, int length);
+    void modifyBytes(int n, int length, unsigned char keep, unsigned char set);
+    int nextDirtyRun(const unsigned int *bits, int n, int *length);
+    void sendRuns(int n);
+#if DEVICE_SPI_ASYNCH
+    void addressSent(int event);
+    void transferComplete(int event);
+#endif
 
 public:
-    unsigned char buffer[84][6];  // screen buffer - the 6 is for the banks - each one is 8 bits;
+    // screen buffer - one row of 84 bytes for each of the 6 banks, so that it is in the same order as
+    // the display RAM. Each byte is a column of 8 pixels. Also accessible as words for bulk operations
+    union {
+        unsigned char buffer[BANKS][WIDTH];
+        uint32_t words[BUFFER_WORDS];
+    };
 
 private:  // private variables
     SPI*    spi;
@@ -336,6 +481,14 @@ private:  // private variables
     DigitalOut* sce;
     DigitalOut* rst;
     DigitalOut* dc;
+    unsigned int dirty[DIRTY_WORDS];  // one bit per byte of the buffer, in the order the display RAM is written
+    unsigned int sending[DIRTY_WORDS];  // bytes of the frame being sent
+    unsigned char frame[WIDTH*BANKS];  // frame being sent, in display RAM order - only touched between transfers
+    volatile int busy;  // a frame is being sent
+    int runStart;  // the run being sent, the next is looked for from its end
+    int runLength;
+    unsigned char address[2];  // its address commands, sent by the SPI interrupt ahead of it
+    void (*refreshCallback)(void);
 
 };
 
@@ -0,0 +1,73 @@
+/**
+@file broadphase.cpp
+
+@brief Broadphase collision index implementation
+
+*/
+
+#include "mbed.h"
+#include "broadphase.h"
+
+// band holding a column, columns off either side of the screen go in the band at that edge
+static int band_of(int x)
+{
+    if (x < 0) {
+        return 0;
+    }
+    if (x >= WIDTH) {
+        return BROAD_BANDS - 1;
+    }
+    return x >> BROAD_BAND_SHIFT;
+}
+
+void broad_clear(broadphase *index)
+{
+    memset(index->band, 0, sizeof(index->band));
+    memset(index->first, -1, sizeof(index->first));
+}
+
+void broad_move(broadphase *index, int i, int x0, int x1)
+{
+    int first = band_of(x0);
+    int last = band_of(x1);
+    int old_first = index->first[i];
+    int old_last = index->last[i];
+
+    if (first == old_first && last == old_last) {
+        return;     // still in the same bands, which is most moves
+    }
+    for (int b = old_first; b >= 0 && b <= old_last; b++) {
+        if (b < first || b > last) {
+            entity_reset(index->band[b], i);
+        }
+    }
+    for (int b = first; b <= last; b++) {
+        if (old_first < 0 || b < old_first || b > old_last) {
+            entity_set(index->band[b], i);
+        }
+    }
+    index->first[i] = first;
+    index->last[i] = last;
+}
+
+void broad_remove(broadphase *index, int i)
+{
+    for (int b = index->first[i]; b >= 0 && b <= index->last[i]; b++) {
+        entity_reset(index->band[b], i);
+    }
+    index->first[i] = -1;
+}
+
+void broad_query(const broadphase *index, int x0, int x1, const uint32_t *filter, uint32_t *result)
+{
+    int first = band_of(x0);
+    int last = band_of(x1);
+
+    for (int w = 0; w < ENTITY_WORDS; w++) {
+        uint32_t bits = 0;
+        for (int b = first; b <= last; b++) {
+            bits |= index->band[b][w];
+        }
+        result[w] = bits & filter[w];
+    }
+}
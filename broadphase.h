@@ -0,0 +1,65 @@
+/**
+@file broadphase.h
+@brief Broadphase collision index for SPACEGAME, bucketing the enemies by bands of screen columns.
+@brief Each band has a bitmask, in the same form as the masks in entity.h, of the enemies that cover any of its
+@brief columns. An enemy's bits only change when it crosses into a different band, and a query only looks at the
+@brief bands under the columns it asks about, so testing a bullet or the ship only visits the enemies near it.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "N5110.h"
+#include "entity.h"
+
+#define BROAD_BAND_SHIFT 3                                              /*!< Bands are 1 << BROAD_BAND_SHIFT columns wide */
+#define BROAD_BANDS ((WIDTH + (1 << BROAD_BAND_SHIFT) - 1) >> BROAD_BAND_SHIFT)   /*!< Number of bands across the screen */
+
+/**
+The index
+@param band - enemies covering each band, off-screen columns count as the nearest band
+@param first - first band each enemy covers, or -1 if it isn't in the index
+@param last - last band each enemy covers
+*/
+struct broadphase {
+    uint32_t band[BROAD_BANDS][ENTITY_WORDS];
+    int8_t first[ENTITY_MAX];
+    int8_t last[ENTITY_MAX];
+};
+
+/**
+Removes every enemy from the index
+@param index - the index
+*/
+void broad_clear(broadphase *index);
+
+/**
+Adds an enemy to the index, or moves it. Only the bands it has entered or left are changed.
+@param index - the index
+@param i - the enemy
+@param x0 - leftmost column it covers
+@param x1 - rightmost column it covers
+*/
+void broad_move(broadphase *index, int i, int x0, int x1);
+
+/**
+Removes an enemy from the index
+@param index - the index
+@param i - the enemy
+*/
+void broad_remove(broadphase *index, int i);
+
+/**
+Finds the enemies that could cover any of a range of columns
+@param index - the index
+@param x0 - leftmost column
+@param x1 - rightmost column
+@param filter - mask of enemies to consider, such as the live mask
+@param result - mask of ENTITY_WORDS words to fill, walk it with entity_find()
+*/
+void broad_query(const broadphase *index, int x0, int x1, const uint32_t *filter, uint32_t *result);
+
+#endif
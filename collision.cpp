@@ -0,0 +1,63 @@
+/**
+@file collision.cpp
+
+@brief Pixel-accurate collision implementation
+
+*/
+
+#include "mbed.h"
+#include "N5110.h"
+#include "collision.h"
+
+int collide_sprites(const Sprite *a, int ax, int ay, const Sprite *b, int bx, int by)
+{
+    int a_left = ax - a->originX;
+    int a_top = ay - a->originY;
+    int b_left = bx - b->originX;
+    int b_top = by - b->originY;
+
+    // bounding boxes first
+    int left = (a_left > b_left) ? a_left : b_left;
+    int right = (a_left + a->width < b_left + b->width) ? a_left + a->width : b_left + b->width;
+    if (left >= right || a_top >= b_top + b->height || b_top >= a_top + a->height) {
+        return 0;
+    }
+
+    // the boxes overlap so the sprites are less than SPRITE_MAX_HEIGHT rows apart, and a shifted column fits in a word
+    int dy = b_top - a_top;
+    for (int x = left; x < right; x++) {
+        uint32_t column_a = a->columns[x - a_left];
+        uint32_t column_b = b->columns[x - b_left];
+        if (dy >= 0 ? (column_a & (column_b << dy)) : ((column_a << -dy) & column_b)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int collide_segment(const Sprite *sprite, int x, int y, int x0, int x1, int row)
+{
+    int left = x - sprite->originX;
+    int r = row - (y - sprite->originY);
+    if (r < 0 || r >= sprite->height) {
+        return 0;
+    }
+    if (x0 < left) {
+        x0 = left;
+    }
+    if (x1 > left + sprite->width - 1) {
+        x1 = left + sprite->width - 1;
+    }
+    uint32_t mask = 1U << r;
+    for (int c = x0; c <= x1; c++) {
+        if (sprite->columns[c - left] & mask) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int collide_head_on(int right0, int right1, int left0, int left1)
+{
+    return right0 <= left0 && right1 >= left1;    // apart before the move, and not any more
+}
@@ -0,0 +1,53 @@
+/**
+@file collision.h
+@brief Pixel-accurate collision tests between sprites for SPACEGAME.
+@brief The bounding boxes of the two sprites are compared first, which rejects almost every pair. Where the boxes
+@brief overlap, each shared column of one sprite is shifted into line with the other and the two are ANDed, so a
+@brief column is tested in one operation rather than pixel by pixel. Bullets are tested as the segment of a row
+@brief their head has swept across since they were last moved, so they can move several pixels at a time without
+@brief passing through anything.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "N5110.h"
+
+/**
+Tests whether two sprites have any set pixels in the same place
+@param a - the first sprite
+@param ax - x-coordinate of the first sprite's reference point
+@param ay - y-coordinate of the first sprite's reference point
+@param b - the second sprite
+@param bx - x-coordinate of the second sprite's reference point
+@param by - y-coordinate of the second sprite's reference point
+@returns 1 if they overlap, 0 otherwise
+*/
+int collide_sprites(const Sprite *a, int ax, int ay, const Sprite *b, int bx, int by);
+
+/**
+Tests whether a horizontal segment of a row crosses any set pixels of a sprite
+@param sprite - the sprite
+@param x - x-coordinate of the sprite's reference point
+@param y - y-coordinate of the sprite's reference point
+@param x0 - leftmost column of the segment
+@param x1 - rightmost column of the segment
+@param row - y-coordinate of the segment
+@returns 1 if they cross, 0 otherwise
+*/
+int collide_segment(const Sprite *sprite, int x, int y, int x0, int x1, int row);
+
+/**
+Tests whether two bullets travelling towards each other along the same row met while they were last moved
+@param right0 - where the head of the bullet moving right started
+@param right1 - where the head of the bullet moving right finished
+@param left0 - where the head of the bullet moving left started
+@param left1 - where the head of the bullet moving left finished
+@returns 1 if they met or passed each other, 0 otherwise
+*/
+int collide_head_on(int right0, int right1, int left0, int left1);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+@file entity.cpp
+
+@brief Structure-of-arrays enemy store implementation
+
+*/
+
+#include "mbed.h"
+#include "entity.h"
+
+void entity_clear(entity_store *store)
+{
+    for (int w = 0; w < ENTITY_WORDS; w++) {
+        store->live[w] = 0;
+        store->waiting[w] = 0;
+        store->bullet_live[w] = 0;
+    }
+}
+
+int entity_find(const uint32_t *mask, int i)
+{
+    if (i >= ENTITY_MAX) {
+        return -1;
+    }
+    int w = i >> 5;
+    uint32_t bits = mask[w] & (~0U << (i & 31));   // ignore the enemies before i in its word
+    while (bits == 0) {
+        if (++w == ENTITY_WORDS) {
+            return -1;
+        }
+        bits = mask[w];
+    }
+    return (w << 5) + __builtin_ctz(bits);          // RBIT and CLZ on the Cortex-M4
+}
+
+int entity_empty(const uint32_t *mask)
+{
+    for (int w = 0; w < ENTITY_WORDS; w++) {
+        if (mask[w]) {
+            return 0;
+        }
+    }
+    return 1;
+}
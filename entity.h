@@ -0,0 +1,92 @@
+/**
+@file entity.h
+@brief Structure-of-arrays store for the enemies in SPACEGAME.
+@brief Each field has its own array of the narrowest type that holds it, and which enemies are alive is kept in
+@brief bitmasks. Loops walk a mask with count-trailing-zeros, so they only visit the enemies in it and pay one word
+@brief test per 32 enemies that are not, rather than testing a flag in every slot.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include <stdint.h>
+
+#ifndef ENTITY_MAX
+#define ENTITY_MAX 32                               /*!< Maximum number of enemies, can be set when building */
+#endif
+#define ENTITY_WORDS ((ENTITY_MAX + 31) / 32)       /*!< Words in each bitmask */
+
+/**
+The enemies, enemy i is made from entry i of each array
+@param x - x-coordinate
+@param y - y-coordinate
+@param length - where the enemy is fully off the screen
+@param clear_object - whether the enemy is cleared from the display when it is hit
+@param live - alive and on the screen
+@param waiting - alive but not on the screen yet
+@param bullet_live - has a bullet in flight
+*/
+struct entity_store {
+    int16_t x[ENTITY_MAX];
+    int8_t y[ENTITY_MAX];
+    int8_t length[ENTITY_MAX];
+    uint8_t clear_object[ENTITY_MAX];
+    uint32_t live[ENTITY_WORDS];
+    uint32_t waiting[ENTITY_WORDS];
+    uint32_t bullet_live[ENTITY_WORDS];
+};
+
+/**
+Removes every enemy and their bullets from the masks, the fields are left as they are
+@param store - the enemies
+*/
+void entity_clear(entity_store *store);
+
+/**
+Finds the next enemy in a mask
+@param mask - one of the masks in the store
+@param i - enemy to start looking from
+@returns the first enemy at or after i in the mask, or -1 if there are none
+*/
+int entity_find(const uint32_t *mask, int i);
+
+/**
+@param mask - one of the masks in the store
+@returns 1 if there are no enemies in the mask, 0 otherwise
+*/
+int entity_empty(const uint32_t *mask);
+
+/**
+Adds an enemy to a mask
+@param mask - one of the masks in the store
+@param i - the enemy
+*/
+inline void entity_set(uint32_t *mask, int i)
+{
+    mask[i >> 5] |= 1U << (i & 31);
+}
+
+/**
+Removes an enemy from a mask
+@param mask - one of the masks in the store
+@param i - the enemy
+*/
+inline void entity_reset(uint32_t *mask, int i)
+{
+    mask[i >> 5] &= ~(1U << (i & 31));
+}
+
+/**
+@param mask - one of the masks in the store
+@param i - the enemy
+@returns 1 if the enemy is in the mask, 0 otherwise
+*/
+inline int entity_test(const uint32_t *mask, int i)
+{
+    return (mask[i >> 5] >> (i & 31)) & 1;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+@file flash_store.cpp
+
+@brief Flash store implementation
+
+*/
+
+#include "mbed.h"
+#include "flash_store.h"
+
+#if defined(TARGET_K64F)
+
+#define FTFE_ERASE_SECTOR 0x09
+#define FTFE_PROGRAM_PHRASE 0x07
+#define FTFE_PHRASE 8          // bytes programmed by each command
+#define FLASH_ERASED 0xFFFFFFFF
+
+// runs the command loaded into FCCOB, returns 1 if it succeeded
+// interrupts are off so that nothing reads flash from the same block while it is busy
+static int flash_command()
+{
+    __disable_irq();
+    FTFE->FSTAT = FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK;     // clear errors from the last command
+    FTFE->FSTAT = FTFE_FSTAT_CCIF_MASK;                                // launch
+    while (!(FTFE->FSTAT & FTFE_FSTAT_CCIF_MASK)) {
+    }
+    int ok = !(FTFE->FSTAT & (FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK | FTFE_FSTAT_MGSTAT0_MASK));
+    __enable_irq();
+    return ok;
+}
+
+static void flash_address(int command, uint32_t address)
+{
+    FTFE->FCCOB0 = command;
+    FTFE->FCCOB1 = address >> 16;
+    FTFE->FCCOB2 = address >> 8;
+    FTFE->FCCOB3 = address;
+}
+
+static int flash_erase_sector()
+{
+    flash_address(FTFE_ERASE_SECTOR, FLASH_STORE_ADDRESS);
+    return flash_command();
+}
+
+// programs 8 bytes, the command takes each word most significant byte first
+static int flash_program_phrase(uint32_t address, const unsigned char *bytes)
+{
+    flash_address(FTFE_PROGRAM_PHRASE, address);
+    FTFE->FCCOB4 = bytes[3];
+    FTFE->FCCOB5 = bytes[2];
+    FTFE->FCCOB6 = bytes[1];
+    FTFE->FCCOB7 = bytes[0];
+    FTFE->FCCOB8 = bytes[7];
+    FTFE->FCCOB9 = bytes[6];
+    FTFE->FCCOBA = bytes[5];
+    FTFE->FCCOBB = bytes[4];
+    return flash_command();
+}
+
+int flash_store_write(const unsigned char *data, int length)
+{
+    if (length < 0 || length > FLASH_STORE_MAX_BYTES || !flash_erase_sector()) {
+        return 0;
+    }
+
+    // the length goes in the first word, the block follows it and the last phrase is padded
+    unsigned char phrase[FTFE_PHRASE];
+    uint32_t address = FLASH_STORE_ADDRESS;
+    int n = -4;
+    while (n < length) {
+        for (int i = 0; i < FTFE_PHRASE; i++, n++) {
+            if (n < 0) {
+                phrase[i] = (uint32_t)length >> (8*(n + 4));
+            } else {
+                phrase[i] = (n < length) ? data[n] : 0xFF;
+            }
+        }
+        if (!flash_program_phrase(address, phrase)) {
+            return 0;
+        }
+        address += FTFE_PHRASE;
+    }
+    return 1;
+}
+
+const unsigned char *flash_store_read(int *length)
+{
+    uint32_t stored = *(const volatile uint32_t *)FLASH_STORE_ADDRESS;
+    if (stored == FLASH_ERASED || stored > FLASH_STORE_MAX_BYTES) {
+        return 0;
+    }
+    *length = stored;
+    return (const unsigned char *)(FLASH_STORE_ADDRESS + 4);
+}
+
+void flash_store_erase()
+{
+    if (*(const volatile uint32_t *)FLASH_STORE_ADDRESS != FLASH_ERASED) {
+        flash_erase_sector();
+    }
+}
+
+#else
+
+int flash_store_write(const unsigned char *data, int length)
+{
+    return 0;
+}
+
+const unsigned char *flash_store_read(int *length)
+{
+    return 0;
+}
+
+void flash_store_erase()
+{
+}
+
+#endif
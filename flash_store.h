@@ -0,0 +1,38 @@
+/**
+@file flash_store.h
+@brief Keeps one block of data in the last sector of the K64F's program flash, where it survives power being removed.
+@brief The sector is in the second flash block, so it can be erased and programmed while the game runs from the first.
+@brief Other targets, and the host, have no store: writes fail and reads find nothing.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#define FLASH_STORE_ADDRESS 0x000FF000     /*!< Start of the sector, the last 4 KB of the 1 MB of flash */
+#define FLASH_STORE_SIZE 4096              /*!< Size of the sector in bytes */
+#define FLASH_STORE_MAX_BYTES (FLASH_STORE_SIZE - 8)     /*!< Largest block that can be kept, after its length */
+
+/**
+Erases the sector and programs a block into it
+@param data - the block
+@param length - length of the block in bytes, at most FLASH_STORE_MAX_BYTES
+@returns 1 if the block was written, 0 if not
+*/
+int flash_store_write(const unsigned char *data, int length);
+
+/**
+Finds the block kept in the sector
+@param length - set to the length of the block in bytes
+@returns the block, read straight from flash, or 0 if there isn't one
+*/
+const unsigned char *flash_store_read(int *length);
+
+/**
+Erases the sector, so that the block is not found again
+*/
+void flash_store_erase();
+
+#endif
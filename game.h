@@ -0,0 +1,106 @@
+/**
+@file game.h
+@brief The state of a game of SPACEGAME, kept together in one context that is passed to the functions that update it.
+@brief Nothing else in the game changes as it plays, apart from the display and the other hardware, so the whole game,
+@brief its timing included, is plain data that can be copied, and several games can run side by side. A copy still
+@brief points at its original through the scheduler's context and report queue, and only the game given to
+@brief sched_init() is driven by the tick interrupt. The fields used on every tick come first so that they share
+@brief cache lines, then the tables the tasks work through, then the fields used now and again.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef GAME_H
+#define GAME_H
+
+#include "hud.h"
+#include "isr_queue.h"
+#include "scheduler.h"
+#include "projectile.h"
+#include "entity.h"
+#include "broadphase.h"
+#include "replay.h"
+#include "prng.h"
+#include "wheel.h"
+
+/**
+A game
+@param state - the current state of the FSM
+@param alive - alive or dead state of the spaceship, 1 or 0, 2 once the game is over
+@param new_state - decides whether the next state should be accessed, 1 or 0
+@param firsttime - 0 until the current state has set itself up, 1 after
+@param ship_x - the x-coordinate of the ship
+@param ship_y - the y-coordinate of the ship
+@param score - score for the game, increases when enemies are killed by the player
+@param number_lives - number of lives the ship has
+@param no_of_obj - number of enemies left in the wave
+@param boss_direction - how the boss is moving: 0 coming in from the right, 1 down, 2 up
+@param random - the game's random number streams, see prng.h
+@param input - the joystick, potentiometer and button, read once each tick
+@param input_tick - scheduler tick the inputs were last read on
+@param task_ship - scheduler task for ship movement
+@param task_fsm - scheduler task for timings in FSM
+@param task_fire - scheduler task for firing, made due by the switch on PCB
+@param task_bullet - scheduler task for bullet speed
+@param sched - the scheduler's task table
+@param bullets - every bullet in flight, the player's and the enemies'
+@param enemies - the enemies, see entity.h, there can be up to ENTITY_MAX
+@param enemy_index - which columns of the screen each live enemy covers
+@param timers - when each enemy comes on screen and next fires
+@param heads_up - score, lives and boundary shown at the top of the display
+@param buffer_score - score buffer used to display the score in a printable string
+@param button_held - 1 while the button on the PCB is held down
+@param held_since - scheduler tick at which the button was pressed
+@param events - button edges and tasks falling due, queued by the interrupts in the order they happened
+@param presses - button presses since the inputs were last read
+@param button - level of the button after the last edge
+@param timer_events - tasks seen falling due
+@param wait_total_us - time from a task falling due to the main loop seeing it, in total
+@param wait_max_us - and at most
+@param fire_trace - latency trace of the last press, see latency.h
+@param move_trace - latency trace of the last joystick movement
+*/
+struct game {
+    int state;
+    int alive;
+    int new_state;
+    int firsttime;
+    int ship_x;
+    int ship_y;
+    int score;
+    int number_lives;
+    int no_of_obj;
+    int boss_direction;
+    prng random;
+    input_state input;
+    unsigned int input_tick;
+    int task_ship;
+    int task_fsm;
+    int task_fire;
+    int task_bullet;
+
+    scheduler sched;
+    projectile_pool bullets;
+    entity_store enemies;
+    broadphase enemy_index;
+    timing_wheel timers;
+
+    hud heads_up;
+    char buffer_score[14];
+    int button_held;
+    unsigned int held_since;
+
+    isr_queue events;
+    int presses;
+    int button;
+    unsigned int timer_events;
+    uint32_t wait_total_us;
+    uint32_t wait_max_us;
+    uint16_t fire_trace;
+    uint16_t move_trace;
+};
+
+extern GAME_LOCAL game g_game;     // the game played on the board, defined in main.h
+
+#endif
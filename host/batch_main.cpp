@@ -0,0 +1,365 @@
+/**
+@file batch_main.cpp
+
+@brief Plays many seeded games of SPACEGAME at once and reports how they went, for tuning
+@brief the state table in main.h.
+
+Each game runs in simulated time on one of a pool of worker threads, which puts the host
+board and the game's context in g_game back as they were at power-up before every game.
+The games are shared out between the workers in blocks, and a worker that runs out steals
+from the back of another's block, because some games end in seconds while others play on
+to the time limit.
+
+Game n is seeded with seed + n, which sets both the game's rand() and the random input
+policy, so a game plays the same whichever worker runs it and however many there are.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "mbed.h"
+#include "host_script.h"
+#include "game.h"
+
+#define STATES 4                // START_STATE to BOSS1_STATE, see main.h
+#define HISTOGRAM_BARS 10
+#define POLICY_STEP_US 40000    // the random policy decides whether to press this often
+
+int spacegame_main();  // main() in main.cpp, renamed by the makefile
+
+
+static const char *s_state_names[STATES] = {"START", "ASTRO1", "ALIEN1", "BOSS1"};
+
+/**
+What happened in one game
+@param seed - seed the game was played with
+@param time_us - simulated time the game lasted
+@param score - final score
+@param over - 1 if all lives were lost, 0 if the time limit was reached first
+@param entered - number of times each state was entered
+@param deaths - number of lives lost in each state
+*/
+struct game_result {
+    unsigned int seed;
+    uint64_t time_us;
+    int score;
+    int over;
+    int entered[STATES];
+    int deaths[STATES];
+};
+
+/**
+Games waiting for a worker, the owner takes from the front and thieves from the back
+*/
+struct work_queue {
+    std::mutex lock;
+    std::deque<int> games;
+};
+
+/**
+Settings shared by every game in the batch
+@param games - number of games
+@param seed - seed of the first game
+@param limit_us - simulated time after which a game is stopped
+@param press_chance - chance in 100 that the policy presses the button at each step
+@param script - text of the input script, 0 to use the random policy
+*/
+struct batch {
+    int games;
+    unsigned int seed;
+    uint64_t limit_us;
+    int press_chance;
+    const char *script;
+};
+
+static thread_local game_result *s_result;     // the game running on this thread
+static thread_local int s_seen_state;
+static thread_local int s_seen_lives;
+
+// called each time round the game's main loop, as it goes to sleep
+static void watch_game()
+{
+    const game *g = &g_game;
+    if (s_seen_lives >= 0 && g->number_lives < s_seen_lives && s_seen_state < STATES) {
+        s_result->deaths[s_seen_state]++;       // the state the ship was in, the loop has already moved on to START
+    }
+    if (g->state != s_seen_state && g->state < STATES) {
+        s_result->entered[g->state]++;
+    }
+    s_seen_state = g->state;
+    s_seen_lives = g->number_lives;
+}
+
+static uint32_t policy_random(uint32_t *state)     // xorshift32
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// presses the button at random and moves the joystick to a random position every so often
+static void random_policy(unsigned int seed, uint64_t limit_us, int press_chance)
+{
+    uint32_t state = seed * 2654435761u + 1;
+    uint64_t next_move = 0;
+
+    for (uint64_t t = 0; t < limit_us; t += POLICY_STEP_US) {
+        if (t >= next_move) {
+            host_input_analog(t, PIN_JOYSTICK_X, (policy_random(&state) % 1001) / 1000.0f);
+            host_input_analog(t, PIN_JOYSTICK_Y, (policy_random(&state) % 1001) / 1000.0f);
+            next_move = t + 200000 + policy_random(&state) % 1300000;
+        }
+        if ((int)(policy_random(&state) % 100) < press_chance) {
+            host_input_edge(t, PIN_BUTTON, 1);
+            host_input_edge(t + POLICY_STEP_US / 2, PIN_BUTTON, 0);
+        }
+    }
+}
+
+static void play_game(const batch *settings, game_result *result)
+{
+    host_reset();       // the worker may have played a game already
+    g_game = game();
+    s_result = result;
+    s_seen_state = -1;
+    s_seen_lives = -1;
+    host_lcd_connect(PIN_LCD_SCE, PIN_LCD_DC);
+    host_input_analog(0, PIN_POT, 0.1f);
+    host_srand(result->seed);
+    if (settings->script) {
+        FILE *file = fmemopen((void *)settings->script, strlen(settings->script), "r");
+        host_script_read(file, "script");
+        fclose(file);
+    } else {
+        random_policy(result->seed, settings->limit_us, settings->press_chance);
+    }
+    host_input_quit(settings->limit_us);
+    host_sleep_hook(&watch_game);
+
+    try {
+        spacegame_main();
+        result->over = 1;
+    } catch (host_quit &) {
+        result->over = 0;
+    }
+    result->time_us = host_clock_us();
+    result->score = g_game.score;
+}
+
+// the next game for a worker, its own if it has any left, otherwise one stolen from another worker
+static int take_game(work_queue *queues, int workers, int self)
+{
+    for (int k = 0; k < workers; k++) {
+        work_queue &queue = queues[(self + k) % workers];
+        std::lock_guard<std::mutex> hold(queue.lock);
+        if (!queue.games.empty()) {
+            int game;
+            if (k == 0) {
+                game = queue.games.front();
+                queue.games.pop_front();
+            } else {
+                game = queue.games.back();
+                queue.games.pop_back();
+            }
+            return game;
+        }
+    }
+    return -1;
+}
+
+static void worker(const batch *settings, work_queue *queues, int workers, int self, game_result *results)
+{
+    int n;
+    while ((n = take_game(queues, workers, self)) >= 0) {
+        play_game(settings, &results[n]);
+    }
+}
+
+// plays the whole batch, returns the wall clock time it took in seconds
+static double run_batch(const batch *settings, int workers, game_result *results)
+{
+    work_queue *queues = new work_queue[workers];
+    for (int n = 0; n < settings->games; n++) {
+        memset(&results[n], 0, sizeof(game_result));
+        results[n].seed = settings->seed + n;
+        queues[(long)n * workers / settings->games].games.push_back(n);
+    }
+
+    uint64_t start = host_wall_clock_us();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+        threads.push_back(std::thread(worker, settings, queues, workers, i, results));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    delete[] queues;
+    return (host_wall_clock_us() - start) / 1000000.0;
+}
+
+static double percentile(std::vector<double> &values, int percent)
+{
+    return values[(values.size() - 1) * percent / 100];
+}
+
+static void report(FILE *out, const batch *settings, const game_result *results)
+{
+    int n = settings->games;
+    int over = 0;
+    int entered[STATES] = {0};
+    int deaths[STATES] = {0};
+    std::vector<double> times;
+    std::vector<double> scores;
+
+    for (int i = 0; i < n; i++) {
+        over += results[i].over;
+        times.push_back(results[i].time_us / 1000000.0);
+        scores.push_back(results[i].score);
+        for (int s = 0; s < STATES; s++) {
+            entered[s] += results[i].entered[s];
+            deaths[s] += results[i].deaths[s];
+        }
+    }
+    std::sort(times.begin(), times.end());
+    std::sort(scores.begin(), scores.end());
+
+    fprintf(out, "%d games, %d game over, %d still playing after %.0f s\n",
+            n, over, n - over, settings->limit_us / 1000000.0);
+    fprintf(out, "survival s:  p10 %.1f  p50 %.1f  p90 %.1f  max %.1f\n",
+            percentile(times, 10), percentile(times, 50), percentile(times, 90), times.back());
+    fprintf(out, "score:       p10 %.0f  p50 %.0f  p90 %.0f  max %.0f\n",
+            percentile(scores, 10), percentile(scores, 50), percentile(scores, 90), scores.back());
+
+    int bar_width = (int)(scores.back() / HISTOGRAM_BARS) + 1;
+    int bars[HISTOGRAM_BARS] = {0};
+    int tallest = 1;
+    for (int i = 0; i < n; i++) {
+        int bar = (int)scores[i] / bar_width;
+        bars[bar]++;
+        tallest = std::max(tallest, bars[bar]);
+    }
+    for (int b = 0; b < HISTOGRAM_BARS; b++) {
+        fprintf(out, "  %5d-%-5d %6d ", b * bar_width, (b + 1) * bar_width - 1, bars[b]);
+        for (int i = 0; i < bars[b] * 50 / tallest; i++) {
+            fputc('#', out);
+        }
+        fputc('\n', out);
+    }
+
+    fprintf(out, "state     entered   deaths   deaths per entry\n");
+    for (int s = 0; s < STATES; s++) {
+        fprintf(out, "%-8s %8d %8d   %.3f\n", s_state_names[s], entered[s], deaths[s],
+                entered[s] ? (double)deaths[s] / entered[s] : 0.0);
+    }
+}
+
+static char *read_file(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", filename);
+        return 0;
+    }
+    std::vector<char> text;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        text.push_back((char)c);
+    }
+    fclose(file);
+    char *copy = (char *)malloc(text.size() + 1);
+    memcpy(copy, text.data(), text.size());
+    copy[text.size()] = 0;
+    return copy;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [-n games] [-j workers] [-l seconds] [-r seed] [-c chance] [-s script] [-S]\n"
+            "  -n  number of games, 1000 by default\n"
+            "  -j  number of worker threads, one per core by default\n"
+            "  -l  stop each game after this much simulated time, 300 s by default\n"
+            "  -r  seed of the first game, 1 by default\n"
+            "  -c  chance in 100 that the random policy presses the button every 40 ms, 50 by default\n"
+            "  -s  play every game from the same script instead of the random policy\n"
+            "  -S  play the batch with 1, 2, 4 ... workers up to -j and report how it scales\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    batch settings = {1000, 1, 300000000, 50, 0};
+    int workers = (int)std::thread::hardware_concurrency();
+    int scaling = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            settings.games = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+            settings.limit_us = (uint64_t)(atof(argv[++i]) * 1000000.0);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            settings.seed = strtoul(argv[++i], 0, 0);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            settings.press_chance = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            settings.script = read_file(argv[++i]);
+            if (!settings.script) {
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-S")) {
+            scaling = 1;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (settings.games < 1 || workers < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // the game prints its own statistics at the end of each game, only the report is wanted
+    FILE *out = fdopen(dup(fileno(stdout)), "w");
+    if (!out || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "cannot redirect the game's output\n");
+        return 1;
+    }
+
+    game_result *results = new game_result[settings.games];
+    double simulated = 0.0;
+    double first = 0.0;
+    int count = scaling ? 1 : workers;
+    for (;;) {
+        double wall = run_batch(&settings, count, results);
+        if (first == 0.0) {
+            first = wall;
+            simulated = 0.0;
+            for (int i = 0; i < settings.games; i++) {
+                simulated += results[i].time_us / 1000000.0;
+            }
+        }
+        fprintf(out, "%2d workers: %.3f s, %.0f games/s, %.0fx real time", count, wall,
+                settings.games / wall, simulated / wall);
+        if (scaling) {
+            fprintf(out, ", %.2fx one worker, %.0f%% efficient", first / wall, 100.0 * first / wall / count);
+        }
+        fputc('\n', out);
+        fflush(out);
+        if (count == workers) {
+            break;
+        }
+        count = std::min(count * 2, workers);
+    }
+    report(out, &settings, results);
+    fclose(out);
+    delete[] results;
+    return 0;
+}
@@ -0,0 +1,697 @@
+/**
+@file host_bench.cpp
+
+@brief Benchmarks and checks of the game's data structures, run with spacegame -b.
+
+Inputs come from the game's own PRNG with a fixed seed, so every run checks the same cases.
+The times are wall clock on the host and only compare one structure with another.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include "mbed.h"
+#include "entity.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "images.h"
+#include "projectile.h"
+#include "prng.h"
+#include "host_bench.h"
+
+extern GAME_LOCAL N5110 lcd;   // the game's display, which the bullets are drawn on
+
+#define BENCH_SEED 2016
+#define POOL_OPERATIONS 200000  // spawns and frees checked against the model
+#define POOL_PASSES 100000      // update passes timed at each number of bullets in flight
+#define ENTITY_LAYOUTS 1000     // random sets of live enemies checked and timed at each number of slots
+#define ENTITY_PASSES 200       // passes timed over each set
+#define BROAD_ROUNDS 2000       // rounds of moves, each followed by queries, at each number of enemies
+#define BROAD_QUERIES 20        // bullet-sized queries after each round of moves
+#define BROAD_HALF_WIDTH 2      // enemies cover the columns this far either side of x, as the sprites do
+#define SPRITE_PLACEMENTS 8000  // placements of each pair of sprites, 200000 in all
+#define SPRITE_REPEATS 20       // times each placement is timed
+#define SWEEP_STEPS 100         // steps a bullet is followed for, long enough to cross the screen at any speed
+
+static volatile int s_sink;     // results are written here so the loops being timed aren't optimised away
+
+static double elapsed_ns(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - from).count();
+}
+
+/**
+A bullet as the game kept them before the pool, a slot for every bullet that could be in flight
+@param x - x-coordinate of the head
+@param dx - direction of travel
+@param live - whether the slot is in use
+*/
+struct flag_bullet {
+    int x;
+    int dx;
+    int live;
+};
+
+/**
+An enemy as the game kept them before the entity store, a structure of fields with a flag for each state
+@param x, y, max_y_offset, min_y_offset, length, iteration - where it is and when it appears
+@param live - alive and on the screen
+@param bullet_x, bullet_y, bullet_live, bullet_length - its bullet
+@param clear_object - whether it is cleared when hit
+*/
+struct flag_enemy {
+    int x;
+    int y;
+    int max_y_offset;
+    int min_y_offset;
+    int length;
+    int iteration;
+    int live;
+    int bullet_x;
+    int bullet_y;
+    int bullet_live;
+    int bullet_length;
+    int clear_object;
+};
+
+// spawns and frees at random, checking the pool against a list kept in the same order
+static int check_pool(prng *random)
+{
+    static projectile_pool pool;
+    std::vector<int> model;
+    int dropped = 0;
+    int high_water = 0;
+    int failures = 0;
+
+    projectile_init(&pool);
+    for (int n = 0; n < POOL_OPERATIONS; n++) {
+        if (model.empty() || prng_below(random, PRNG_EFFECTS, 100) < 55) {
+            int owner = n % ENTITY_MAX;
+            projectile *p = projectile_spawn(&pool, 0, 0, 1, owner);
+            if (model.size() == PROJECTILE_MAX) {
+                dropped++;
+                failures += p != NULL;
+            } else {
+                model.push_back(owner);
+                failures += p == NULL || p != &pool.live[model.size() - 1];
+            }
+        } else {
+            int i = prng_below(random, PRNG_EFFECTS, model.size());
+            projectile_free(&pool, i);
+            model[i] = model.back();
+            model.pop_back();
+        }
+        if ((int)model.size() > high_water) {
+            high_water = model.size();
+        }
+        if (pool.count != (int)model.size()) {
+            failures++;
+            break;
+        }
+        for (int i = 0; i < pool.count; i++) {
+            failures += pool.live[i].owner != model[i];
+        }
+    }
+    failures += pool.dropped != dropped || pool.high_water != high_water;
+    printf("pool: %d spawns and frees checked, %d dropped when full, %d mismatched\n", POOL_OPERATIONS, dropped,
+           failures);
+    return failures;
+}
+
+// times a pass over the bullets in flight, as move_bullets() makes each time they are stepped, and a bullet
+// spent and another fired, both with a slot for each bullet and with the pool
+static void time_pool(int in_flight)
+{
+    static projectile_pool pool;
+    static flag_bullet flags[PROJECTILE_MAX];
+
+    projectile_init(&pool);
+    memset(flags, 0, sizeof(flags));
+    for (int i = 0; i < in_flight; i++) {
+        projectile_spawn(&pool, i, 0, 1, 0);
+        flags[i * PROJECTILE_MAX / in_flight].live = 1;     // spread out, as bullets are freed in any order
+        flags[i * PROJECTILE_MAX / in_flight].dx = 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int n = 0; n < POOL_PASSES; n++) {
+        for (int i = 0; i < PROJECTILE_MAX; i++) {
+            if (flags[i].live) {
+                flags[i].x += flags[i].dx;
+            }
+        }
+        s_sink = flags[n % PROJECTILE_MAX].x;
+    }
+    double flag_ns = elapsed_ns(start) / POOL_PASSES;
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < POOL_PASSES; n++) {
+        for (int i = 0; i < pool.count; i++) {
+            pool.live[i].x += pool.live[i].dx;
+        }
+        s_sink = pool.live[n % in_flight].x;
+    }
+    double pool_ns = elapsed_ns(start) / POOL_PASSES;
+
+    // a bullet spent and another fired, the slots keep a list of the ones in use as the game would have to
+    static int in_use[PROJECTILE_MAX];
+    for (int i = 0; i < in_flight; i++) {
+        in_use[i] = i * PROJECTILE_MAX / in_flight;
+    }
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < POOL_PASSES; n++) {
+        int spent = n % in_flight;
+        flags[in_use[spent]].live = 0;
+        int slot = 0;
+        while (flags[slot].live) {
+            slot++;
+        }
+        flags[slot].live = 1;
+        flags[slot].x = n;
+        in_use[spent] = slot;
+        s_sink = slot;
+    }
+    double flag_churn_ns = elapsed_ns(start) / POOL_PASSES;
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < POOL_PASSES; n++) {
+        projectile_free(&pool, n % in_flight);
+        projectile_spawn(&pool, n, 0, 1, 0);
+        s_sink = pool.live[n % in_flight].x;
+    }
+    double pool_churn_ns = elapsed_ns(start) / POOL_PASSES;
+
+    printf("%9d %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", in_flight, flag_ns, pool_ns, flag_churn_ns, pool_churn_ns);
+}
+
+static int bench_pool()
+{
+    prng random;
+    prng_seed(&random, BENCH_SEED);
+    int failures = check_pool(&random);
+
+    static const int in_flight[] = {4, 16, PROJECTILE_MAX};
+    printf("pool: a pass over the bullets in flight, then a bullet spent and another fired, a slot for each or the pool\n");
+    printf("in flight    pass, slots     pass, pool   fired, slots    fired, pool\n");
+    for (unsigned int i = 0; i < sizeof(in_flight) / sizeof(in_flight[0]); i++) {
+        time_pool(in_flight[i]);
+    }
+    return failures != 0;
+}
+
+// a pass over the live enemies as movement() makes, with 10 to 19 alive as in a wave, against one that tests
+// every slot's flag, checking both find the same enemies
+static int bench_slots(prng *random, int slots)
+{
+    static flag_enemy flags[ENTITY_MAX];
+    static entity_store store;
+    double flag_ns = 0.0;
+    double mask_ns = 0.0;
+    int failures = 0;
+
+    for (int layout = 0; layout < ENTITY_LAYOUTS; layout++) {
+        memset(flags, 0, sizeof(flags));
+        memset(&store, 0, sizeof(store));
+        int alive = 10 + prng_below(random, PRNG_EFFECTS, 10);
+        for (int n = 0; n < alive; n++) {
+            int i = prng_below(random, PRNG_EFFECTS, slots);
+            flags[i].live = 1;
+            flags[i].x = store.x[i] = i + 1;
+            entity_set(store.live, i);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int flag_sum = 0;
+        for (int pass = 0; pass < ENTITY_PASSES; pass++) {
+            for (int i = 0; i < slots; i++) {
+                if (flags[i].live) {
+                    flag_sum += flags[i].x;
+                }
+            }
+            s_sink = flag_sum;
+        }
+        flag_ns += elapsed_ns(start);
+
+        start = std::chrono::steady_clock::now();
+        int mask_sum = 0;
+        for (int pass = 0; pass < ENTITY_PASSES; pass++) {
+            for (int i = entity_find(store.live, 0); i >= 0; i = entity_find(store.live, i + 1)) {
+                mask_sum += store.x[i];
+            }
+            s_sink = mask_sum;
+        }
+        mask_ns += elapsed_ns(start);
+        failures += flag_sum != mask_sum;
+    }
+    printf("%9d %9.1f ns %9.1f ns\n", slots, flag_ns / ENTITY_LAYOUTS / ENTITY_PASSES,
+           mask_ns / ENTITY_LAYOUTS / ENTITY_PASSES);
+    return failures;
+}
+
+static int bench_entities()
+{
+    static const int slots[] = {20, 100, 500};
+    prng random;
+    prng_seed(&random, BENCH_SEED);
+    int failures = 0;
+
+    // every enemy alone, then next to the ends of a word, then all of them
+    static uint32_t mask[ENTITY_WORDS];
+    for (int i = 0; i < ENTITY_MAX; i++) {
+        memset(mask, 0, sizeof(mask));
+        entity_set(mask, i);
+        failures += entity_find(mask, 0) != i || entity_find(mask, i + 1) != -1 || entity_empty(mask);
+        failures += entity_find(mask, i) != i;
+    }
+    memset(mask, 0xFF, sizeof(mask));
+    for (int i = 0; i < ENTITY_MAX; i++) {
+        failures += entity_find(mask, i) != i;
+    }
+
+    printf("entities: one pass over 10 to 19 live enemies, testing each slot or walking the live mask\n");
+    printf("    slots  flag scan   mask walk\n");
+    for (unsigned int i = 0; i < sizeof(slots) / sizeof(slots[0]); i++) {
+        if (slots[i] > ENTITY_MAX) {
+            printf("%9d   needs ENTITY_MAX of at least %d, as in spacegame-large\n", slots[i], slots[i]);
+            continue;
+        }
+        failures += bench_slots(&random, slots[i]);
+    }
+    printf("entities: %d mismatched\n", failures);
+    return failures != 0;
+}
+
+// the columns an enemy covers, clipped to a band as band_of() does
+static int clip_band(int x)
+{
+    return x < 0 ? 0 : x >= WIDTH ? BROAD_BANDS - 1 : x >> BROAD_BAND_SHIFT;
+}
+
+// moves enemies spread across the screen and queries the columns of a bullet's head, comparing the index with
+// testing every enemy, and checking the index's candidates are exactly the enemies in the bands queried. The screen
+// stays the same width, so the enemies in each band, and the hits, grow with the number of enemies: the index cuts
+// the cost by a constant factor, the share of the screen a query's bands cover, rather than changing how it grows
+static int bench_broad_enemies(prng *random, int enemies)
+{
+    static broadphase index;
+    static int x[ENTITY_MAX];
+    static uint32_t live[ENTITY_WORDS];
+    double pairs_ns = 0.0;
+    double index_ns = 0.0;
+    long candidates = 0;
+    long hits = 0;
+    long queries = 0;
+    int failures = 0;
+
+    broad_clear(&index);
+    memset(live, 0, sizeof(live));
+    for (int i = 0; i < enemies; i++) {
+        x[i] = prng_below(random, PRNG_EFFECTS, WIDTH + 8) - 4;
+        broad_move(&index, i, x[i] - BROAD_HALF_WIDTH, x[i] + BROAD_HALF_WIDTH);
+        entity_set(live, i);
+    }
+
+    for (int round = 0; round < BROAD_ROUNDS; round++) {
+        for (int i = 0; i < enemies; i++) {         // most step left a column, a few are shot or come back on
+            int r = prng_below(random, PRNG_EFFECTS, 100);
+            if (r < 2 && entity_test(live, i)) {
+                entity_reset(live, i);
+                broad_remove(&index, i);
+                continue;
+            }
+            if (r < 4 || x[i] < -4) {
+                x[i] = prng_below(random, PRNG_EFFECTS, WIDTH + 8) - 4;
+                entity_set(live, i);
+            } else {
+                x[i]--;
+            }
+            if (entity_test(live, i)) {
+                broad_move(&index, i, x[i] - BROAD_HALF_WIDTH, x[i] + BROAD_HALF_WIDTH);
+            }
+        }
+
+        int x0[BROAD_QUERIES];
+        for (int q = 0; q < BROAD_QUERIES; q++) {
+            x0[q] = prng_below(random, PRNG_EFFECTS, WIDTH);
+        }
+        static uint32_t pairs_hits[BROAD_QUERIES][ENTITY_WORDS];
+        static uint32_t index_hits[BROAD_QUERIES][ENTITY_WORDS];
+        static uint32_t near[BROAD_QUERIES][ENTITY_WORDS];
+        memset(pairs_hits, 0, sizeof(pairs_hits));
+        memset(index_hits, 0, sizeof(index_hits));
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int q = 0; q < BROAD_QUERIES; q++) {
+            for (int i = 0; i < enemies; i++) {
+                if (entity_test(live, i) && x[i] - BROAD_HALF_WIDTH <= x0[q] + 1 && x[i] + BROAD_HALF_WIDTH >= x0[q]) {
+                    entity_set(pairs_hits[q], i);
+                }
+            }
+        }
+        pairs_ns += elapsed_ns(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < BROAD_QUERIES; q++) {
+            broad_query(&index, x0[q], x0[q] + 1, live, near[q]);
+            for (int i = entity_find(near[q], 0); i >= 0; i = entity_find(near[q], i + 1)) {
+                if (x[i] - BROAD_HALF_WIDTH <= x0[q] + 1 && x[i] + BROAD_HALF_WIDTH >= x0[q]) {
+                    entity_set(index_hits[q], i);
+                }
+            }
+        }
+        index_ns += elapsed_ns(start);
+
+        for (int q = 0; q < BROAD_QUERIES; q++) {
+            for (int i = 0; i < enemies; i++) {
+                int in_bands = entity_test(live, i) && clip_band(x[i] - BROAD_HALF_WIDTH) <= clip_band(x0[q] + 1) &&
+                               clip_band(x[i] + BROAD_HALF_WIDTH) >= clip_band(x0[q]);
+                failures += entity_test(near[q], i) != in_bands;
+                failures += entity_test(index_hits[q], i) != entity_test(pairs_hits[q], i);
+                candidates += entity_test(near[q], i);
+                hits += entity_test(pairs_hits[q], i);
+            }
+            queries++;
+        }
+    }
+    printf("%9d %9.1f ns %9.1f ns %11.1f %7.1f %8.1fx\n", enemies, pairs_ns / queries, index_ns / queries,
+           (double)candidates / queries, (double)hits / queries, pairs_ns / index_ns);
+    return failures;
+}
+
+static int bench_broadphase()
+{
+    static const int enemies[] = {20, 100, 500};
+    prng random;
+    prng_seed(&random, BENCH_SEED);
+    int failures = 0;
+
+    printf("broadphase: the enemies a bullet's head touches, testing every enemy or querying the index\n");
+    printf("  enemies  all pairs       index   candidates    hits  speed-up\n");
+    for (unsigned int i = 0; i < sizeof(enemies) / sizeof(enemies[0]); i++) {
+        if (enemies[i] > ENTITY_MAX) {
+            printf("%9d   needs ENTITY_MAX of at least %d, as in spacegame-large\n", enemies[i], enemies[i]);
+            continue;
+        }
+        failures += bench_broad_enemies(&random, enemies[i]);
+    }
+    printf("broadphase: %d mismatched\n", failures);
+    return failures != 0;
+}
+
+/**
+A sprite with the image it was packed from
+@param name - what it is
+@param sprite - the sprite
+@param points - the image
+*/
+struct bench_sprite {
+    const char *name;
+    const Sprite *sprite;
+    const image *points;
+};
+
+static const bench_sprite s_sprites[] = {
+    {"spaceship", &spaceship_sprite, spaceship},
+    {"asteroid", &asteroid_sprite, asteroid},
+    {"enemy", &enemy_spaceship_sprite, enemy_spaceship},
+    {"boss", &boss1_sprite, boss1},
+    {"point", &point_sprite, point},
+};
+
+#define SPRITES (int)(sizeof(s_sprites) / sizeof(s_sprites[0]))
+
+// whether any point of one image lands on a point of the other, straight from the lists of points
+static int images_overlap(const image *a, int ax, int ay, const image *b, int bx, int by)
+{
+    for (int i = 0; a[i].x != IMAGE_END; i++) {
+        for (int j = 0; b[j].x != IMAGE_END; j++) {
+            if (ax + a[i].x == bx + b[j].x && ay + a[i].y == by + b[j].y) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int boxes_overlap(const Sprite *a, int ax, int ay, const Sprite *b, int bx, int by)
+{
+    int a_left = ax - a->originX;
+    int a_top = ay - a->originY;
+    int b_left = bx - b->originX;
+    int b_top = by - b->originY;
+    return a_left < b_left + b->width && b_left < a_left + a->width &&
+           a_top < b_top + b->height && b_top < a_top + a->height;
+}
+
+/**
+Where the second sprite of a pair is put, relative to the first
+@param dx, dy - offset of its reference point
+@param boxes - whether the bounding boxes overlap there
+*/
+struct placement {
+    int dx;
+    int dy;
+    int boxes;
+};
+
+// places every pair of sprites around each other, checking collide_sprites() against the image points, and times
+// it where the boxes overlap and where they don't
+static int bench_sprites()
+{
+    static placement placements[SPRITE_PLACEMENTS];
+    prng random;
+    prng_seed(&random, BENCH_SEED);
+    double ns[2] = {0.0, 0.0};
+    long tests[2] = {0, 0};
+    long overlaps = 0;
+    int failures = 0;
+
+    for (int a = 0; a < SPRITES; a++) {
+        for (int b = 0; b < SPRITES; b++) {
+            const Sprite *sa = s_sprites[a].sprite;
+            const Sprite *sb = s_sprites[b].sprite;
+            int reach_x = sa->width + sb->width;     // far enough that the boxes can be apart on either side
+            int reach_y = sa->height + sb->height;
+            for (int n = 0; n < SPRITE_PLACEMENTS; n++) {
+                placement *p = &placements[n];
+                p->dx = (int)prng_below(&random, PRNG_EFFECTS, 2*reach_x + 1) - reach_x;
+                p->dy = (int)prng_below(&random, PRNG_EFFECTS, 2*reach_y + 1) - reach_y;
+                p->boxes = boxes_overlap(sa, 0, 0, sb, p->dx, p->dy);
+                int expected = images_overlap(s_sprites[a].points, WIDTH/2, HEIGHT/2, s_sprites[b].points,
+                                              WIDTH/2 + p->dx, HEIGHT/2 + p->dy);
+                int found = collide_sprites(sa, WIDTH/2, HEIGHT/2, sb, WIDTH/2 + p->dx, HEIGHT/2 + p->dy);
+                if (found != expected) {
+                    if (failures < 10) {
+                        printf("sprites: %s and %s at %d,%d: %d, the points give %d\n", s_sprites[a].name,
+                               s_sprites[b].name, p->dx, p->dy, found, expected);
+                    }
+                    failures++;
+                }
+                overlaps += expected;
+            }
+            for (int boxes = 0; boxes < 2; boxes++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                int hits = 0;
+                for (int repeat = 0; repeat < SPRITE_REPEATS; repeat++) {
+                    for (int n = 0; n < SPRITE_PLACEMENTS; n++) {
+                        if (placements[n].boxes == boxes) {
+                            hits += collide_sprites(sa, WIDTH/2, HEIGHT/2, sb, WIDTH/2 + placements[n].dx,
+                                                    HEIGHT/2 + placements[n].dy);
+                            tests[boxes]++;
+                        }
+                    }
+                }
+                s_sink = hits;
+                ns[boxes] += elapsed_ns(start);
+            }
+        }
+    }
+    printf("sprites: %d placements of %d pairs, %ld overlapping, %d mismatched\n", SPRITE_PLACEMENTS * SPRITES * SPRITES,
+           SPRITES * SPRITES, overlaps, failures);
+    printf("sprites: %.1f ns a test where the boxes overlap, %.1f ns where they don't\n", ns[1] / tests[1],
+           ns[0] / tests[0]);
+    return failures != 0;
+}
+
+// the first step in which the heads of two bullets fired towards each other are drawn in the same column or
+// have passed, found a pixel at a time
+static int heads_meet(int right, int left)
+{
+    for (int step = 1; step <= SWEEP_STEPS; step++) {
+        for (int pixel = 0; pixel < PROJECTILE_SPEED; pixel++) {
+            if (right >= left) {
+                return step;
+            }
+            right++;
+            left--;
+        }
+    }
+    return 0;
+}
+
+// two bullets fired at each other from every pair of columns along a row, stepped as move_bullets() steps them and
+// tested as player_bullet_hits() tests them, must be found to hit in the step their heads meet or the one after,
+// however far they move in a step
+static int check_head_on(int *pairs)
+{
+    static projectile_pool pool;
+    int failures = 0;
+
+    for (int right = 5; right < 40; right++) {
+        for (int left = right + 1; left < WIDTH; left++) {
+            projectile_init(&pool);
+            projectile *p = projectile_spawn(&pool, right, 10, 1, PROJECTILE_PLAYER);
+            projectile *q = projectile_spawn(&pool, left, 10, -1, 0);
+            int meet = heads_meet(right, left);
+            int hit = 0;
+            for (int step = 1; step <= SWEEP_STEPS && !hit; step++) {
+                if (projectile_step(p, &lcd) == 0 || projectile_step(q, &lcd) == 0) {
+                    break;
+                }
+                int p0, p1, q0, q1;
+                projectile_swept(p, &p0, &p1);
+                projectile_swept(q, &q0, &q1);
+                if (collide_head_on(p0, p1, q1, q0)) {
+                    hit = step;
+                }
+            }
+            if (hit == 0 || hit < meet || hit > meet + 1) {
+                if (failures < 10) {
+                    printf("sweep: bullets from %d and %d met in step %d, hit in step %d\n", right, left, meet, hit);
+                }
+                failures++;
+            }
+            (*pairs)++;
+        }
+    }
+    return failures;
+}
+
+// fires a bullet along a row at a sprite, which steps towards it every so many of the bullet's steps or not at all,
+// as an enemy or the ship does, and tests the bullet as the game does
+// returns the step it hit in, or 0 if it went off the screen first
+static int fire_at(const Sprite *sprite, int x, int y, int row, int dx, int every)
+{
+    static projectile_pool pool;
+    projectile_init(&pool);
+    projectile *p = projectile_spawn(&pool, dx > 0 ? 0 : WIDTH - 1, row, dx, dx > 0 ? PROJECTILE_PLAYER : 0);
+    for (int step = 1; step <= SWEEP_STEPS; step++) {
+        if (every > 0 && step % every == 0) {
+            x -= dx;
+        }
+        projectile_step(p, &lcd);
+        if (p->length == 0 || (dx > 0 ? p->from >= WIDTH : p->from <= -1)) {
+            return 0;
+        }
+        int x0, x1;
+        projectile_swept(p, &x0, &x1);
+        if (collide_segment(sprite, x, y, x0, x1, row)) {
+            return step;
+        }
+    }
+    return 0;
+}
+
+// whether a row of a sprite has any pixels set
+static int row_set(const Sprite *sprite, int y, int row)
+{
+    int r = row - (y - sprite->originY);
+    if (r < 0 || r >= sprite->height) {
+        return 0;
+    }
+    for (int c = 0; c < sprite->width; c++) {
+        if (sprite->columns[c] & (1U << r)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// bullets along every row of each sprite and the rows that graze it, from both sides, at targets standing still or
+// coming towards the bullet: a bullet on a row with pixels must hit, and one on a row without must pass
+static int check_tunnelling(int *shots, int *grazes)
+{
+    int failures = 0;
+    for (int s = 0; s < SPRITES; s++) {
+        const Sprite *sprite = s_sprites[s].sprite;
+        int y = HEIGHT / 2;
+        for (int row = y - sprite->originY - 1; row <= y - sprite->originY + sprite->height; row++) {
+            int expected = row_set(sprite, y, row);
+            for (int dx = -1; dx <= 1; dx += 2) {
+                for (int x = 30; x < 60; x++) {
+                    for (int every = 0; every <= 10; every++) {
+                        int hit = fire_at(sprite, x, y, row, dx, every) != 0;
+                        if (hit != expected) {
+                            if (failures < 10) {
+                                printf("sweep: bullet moving %+d along row %d at the %s from %d, stepping every %d: %s\n",
+                                       dx, row - y, s_sprites[s].name, x, every, hit ? "hit" : "missed");
+                            }
+                            failures++;
+                        }
+                        if (expected) {
+                            (*shots)++;
+                        } else {
+                            (*grazes)++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+static int bench_sweep()
+{
+    int pairs = 0;
+    int shots = 0;
+    int grazes = 0;
+    int failures = check_head_on(&pairs);
+    failures += check_tunnelling(&shots, &grazes);
+    printf("sweep: %d pixels a step, %d head-on pairs, %d shots and %d grazing misses, %d mismatched\n",
+           PROJECTILE_SPEED, pairs, shots, grazes, failures);
+    return failures != 0;
+}
+
+/**
+A benchmark
+@param name - what -b calls it
+@param run - runs it, returning 1 if a check failed
+*/
+struct bench {
+    const char *name;
+    int (*run)();
+};
+
+static const bench s_benches[] = {
+    {"pool", bench_pool},
+    {"entities", bench_entities},
+    {"broadphase", bench_broadphase},
+    {"sprites", bench_sprites},
+    {"sweep", bench_sweep},
+};
+
+#define BENCHES (int)(sizeof(s_benches) / sizeof(s_benches[0]))
+
+int host_bench(const char *name)
+{
+    int found = 0;
+    int failed = 0;
+    for (int i = 0; i < BENCHES; i++) {
+        if (!strcmp(name, "all") || !strcmp(name, s_benches[i].name)) {
+            found = 1;
+            failed |= s_benches[i].run();
+        }
+    }
+    return found ? failed : -1;
+}
+
+void host_bench_list(FILE *file)
+{
+    for (int i = 0; i < BENCHES; i++) {
+        fprintf(file, " %s", s_benches[i].name);
+    }
+    fprintf(file, " all\n");
+}
@@ -0,0 +1,30 @@
+/**
+@file host_bench.h
+
+@brief Benchmarks and checks of the game's data structures, run with spacegame -b.
+
+Each benchmark times a structure the game uses against the simpler one it replaced, and checks
+the two give the same answers. Enemy counts the build has no room for are skipped, so the
+figures at 500 enemies come from spacegame-large.
+
+*/
+
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+#include <cstdio>
+
+/**
+Runs a benchmark and prints what it measured
+@param name - the benchmark's name, or "all" for every one in turn
+@returns 0 if its checks passed, 1 if any failed, -1 if there is no benchmark of that name
+*/
+int host_bench(const char *name);
+
+/**
+Prints the names host_bench() takes
+@param file - where to print them
+*/
+void host_bench_list(FILE *file);
+
+#endif
@@ -0,0 +1,267 @@
+/**
+@file host_main.cpp
+
+@brief Runs SPACEGAME as a Linux executable, driven by an input script.
+
+The script format is described in host_script.h.
+
+Time is simulated unless -r or -t is given: the clock jumps from one interrupt to the next,
+so a run takes as long as the game's computation and is the same every time.
+
+-o records the game's seed and inputs, and -i replays a recording made here or on the board
+(a capture of the board's serial output can be replayed as it is). Both print a checksum of
+the whole game at the end, which is the same for a recording and its replay.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "mbed.h"
+#include "scheduler.h"
+#include "host_script.h"
+#include "game.h"
+#include "snapshot.h"
+#include "replay.h"
+#include "latency.h"
+#include "profile.h"
+#include "host_bench.h"
+
+#define REWIND_FRAMES 250      // frames of history kept by the snapshot benchmark, 5 s at the scheduler's tick
+
+int spacegame_main();  // main() in main.cpp, renamed by the makefile
+
+extern GAME_LOCAL N5110 lcd;   // the game's display, defined in main.h
+
+/**
+What the snapshot benchmark has measured
+@param frames - number of snapshots taken
+@param save_ns - total time spent saving
+@param restore_ns - total time spent restoring
+@param bytes - total length of the blobs
+@param smallest - shortest blob
+@param largest - longest blob
+@param mismatches - restores that didn't give back the game that was saved
+@param failures - saves or restores that failed
+@param history - the last REWIND_FRAMES blobs, as rewinding would keep them
+*/
+struct snapshot_bench {
+    long frames;
+    double save_ns;
+    double restore_ns;
+    long bytes;
+    int smallest;
+    int largest;
+    long mismatches;
+    long failures;
+    unsigned char history[REWIND_FRAMES][SNAPSHOT_MAX_BYTES];
+};
+
+static snapshot_bench s_bench;
+static int s_snapshots;
+static int s_full_frames;
+static int s_fixed_tick;
+static FILE *s_record;
+static std::vector<unsigned char> s_recording;
+
+static double elapsed_ns(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - from).count();
+}
+
+// called from the sleep hook: saves the game, restores it in place and checks nothing changed
+static void bench_snapshot()
+{
+    static game before;
+    static unsigned char frame[BANKS][WIDTH];
+    snapshot_bench *b = &s_bench;
+    unsigned char *blob = b->history[b->frames % REWIND_FRAMES];
+
+    memcpy(&before, &g_game, sizeof(game));
+    memcpy(frame, lcd.buffer, sizeof(frame));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int length = snapshot_save(&g_game, &lcd, blob, SNAPSHOT_MAX_BYTES);
+    b->save_ns += elapsed_ns(start);
+    start = std::chrono::steady_clock::now();
+    int restored = length > 0 && snapshot_restore(&g_game, &lcd, blob, length);
+    b->restore_ns += elapsed_ns(start);
+
+    if (!restored) {
+        b->failures++;
+        return;
+    }
+    // the timers may be linked in a different order, which doesn't change when they fall due, so the
+    // restored game is checked by saving it again, and everything else byte for byte
+    static unsigned char again[SNAPSHOT_MAX_BYTES];
+    before.timers = g_game.timers;
+    if (memcmp(&before, &g_game, sizeof(game)) || memcmp(frame, lcd.buffer, sizeof(frame)) ||
+            snapshot_save(&g_game, &lcd, again, sizeof(again)) != length || memcmp(blob, again, length)) {
+        b->mismatches++;
+    }
+    if (b->frames == 0 || length < b->smallest) {
+        b->smallest = length;
+    }
+    if (length > b->largest) {
+        b->largest = length;
+    }
+    b->bytes += length;
+    b->frames++;
+}
+
+static void print_snapshot_bench()
+{
+    const snapshot_bench *b = &s_bench;
+    if (b->frames == 0) {
+        return;
+    }
+    printf("snapshots: %ld, save %.0f ns, restore %.0f ns, %d/%ld/%d bytes min/mean/max of %d unpacked\n",
+           b->frames, b->save_ns / b->frames, b->restore_ns / b->frames, b->smallest, b->bytes / b->frames,
+           b->largest, (int)(sizeof(game) + BANKS*WIDTH));
+    printf("snapshots: %ld mismatched, %ld failed, %d s of rewind in %ld bytes\n", b->mismatches, b->failures,
+           (int)(REWIND_FRAMES * SCHED_TICK), b->bytes / b->frames * REWIND_FRAMES);
+}
+
+// called each time the game sleeps, which is at least once round its main loop
+static void sleep_hook()
+{
+    if (s_fixed_tick && g_game.sched.context) {     // once main() has set up the scheduler
+        sched_fixed_tick(1);
+        s_fixed_tick = 0;
+    }
+    if (s_full_frames) {
+        lcd.invalidate();   // the next refresh sends the whole frame, as it did before only changed bytes were sent
+    }
+    if (s_snapshots) {
+        bench_snapshot();
+    }
+}
+
+static int record_sink(const unsigned char *data, int length)
+{
+    return fwrite(data, 1, length, s_record);
+}
+
+static int load_recording(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", filename);
+        return 0;
+    }
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        s_recording.push_back((unsigned char)c);
+    }
+    fclose(file);
+    if (!replay_play(s_recording.data(), s_recording.size())) {
+        fprintf(stderr, "no recording found in %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+// FNV-1a of the game saved as a snapshot, so that two runs can be compared
+static uint32_t game_checksum()
+{
+    static unsigned char blob[SNAPSHOT_MAX_BYTES];
+    int length = snapshot_save(&g_game, &lcd, blob, sizeof(blob));
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ blob[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [-s script] [-p pbm-directory] [-r] [-t] [-q seconds] [-k] [-f] [-T] [-o recording] [-i recording] [-b benchmark]\n"
+            "  -s  drive the inputs from a script\n"
+            "  -p  write each frame to a PBM file in the directory\n"
+            "  -r  run in real time instead of simulated time\n"
+            "  -t  draw each frame on the terminal, in real time\n"
+            "  -q  quit after the given time\n"
+            "  -k  save and restore the game each frame and report how long it takes\n"
+            "  -f  send the whole frame on every refresh, to compare the SPI bytes with sending changes only\n"
+            "  -T  take every scheduler tick with an interrupt, to compare with taking only the ticks needed\n"
+            "  -o  record the seed and inputs to a file\n"
+            "  -i  replay a recording instead of reading the inputs\n"
+            "  -b  run a benchmark of the game's data structures instead of the game, one of", program);
+    host_bench_list(stderr);
+}
+
+int main(int argc, char **argv)
+{
+    host_lcd_connect(PIN_LCD_SCE, PIN_LCD_DC);
+    host_input_analog(0, PIN_POT, 0.1f);  // ship speed, as the pot would be set on the board
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            if (!host_script_load(argv[++i])) {
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            host_frames_pbm(argv[++i]);
+        } else if (!strcmp(argv[i], "-r")) {
+            host_clock_real_time(1);
+        } else if (!strcmp(argv[i], "-t")) {
+            host_frames_terminal(1);
+            host_clock_real_time(1);
+        } else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+            host_input_quit((uint64_t)(atof(argv[++i]) * 1000000.0));
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            s_record = fopen(argv[++i], "wb");
+            if (!s_record) {
+                fprintf(stderr, "cannot create %s\n", argv[i]);
+                return 1;
+            }
+            replay_record(&record_sink);
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            if (!load_recording(argv[++i])) {
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-k")) {
+            s_snapshots = 1;
+        } else if (!strcmp(argv[i], "-f")) {
+            s_full_frames = 1;
+        } else if (!strcmp(argv[i], "-T")) {
+            s_fixed_tick = 1;
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            int result = host_bench(argv[++i]);
+            if (result < 0) {
+                usage(argv[0]);
+            }
+            return result != 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    host_sleep_hook(&sleep_hook);
+    try {
+        spacegame_main();
+    } catch (host_quit &) {
+        replay_close(g_game.sched.ticks);
+        sched_print_stats();
+        replay_print_stats();
+        latency_print_stats();
+        profile_dump();
+    }
+    if (s_record) {
+        fclose(s_record);
+    }
+
+    double simulated = host_clock_us() / 1000000.0;
+    double wall = host_wall_clock_us() / 1000000.0;
+    host_frame_print();
+    printf("time %.3f s in %.3f s wall clock, %.0fx real time\n", simulated, wall,
+           wall > 0.0 ? simulated / wall : 0.0);
+    printf("SPI bytes: %lu data, %lu command\n", g_host_lcd.data_bytes, g_host_lcd.command_bytes);
+    print_snapshot_bench();
+    if (replay_active()) {
+        printf("game checksum %08x\n", game_checksum());
+    }
+    return 0;
+}
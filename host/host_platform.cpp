@@ -0,0 +1,483 @@
+/**
+@file host_platform.cpp
+
+@brief Host platform implementation. Timer interrupts and scripted input are dispatched in
+@brief timestamp order from host_sleep() and host_wait_us(), so "ISRs" always run on the game's
+@brief thread between statements of the game loop, as they would interrupt it on the board.
+@brief All of the platform's state is thread-local, so each thread runs its own board.
+@brief By default the clock is virtual: it only moves when the game sleeps or waits, and then
+@brief jumps straight to the next event, so a run is deterministic and as fast as the CPU allows.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include "host_platform.h"
+
+#define HOST_MAX_INPUTS 65536
+
+#define INPUT_ANALOG 0
+#define INPUT_EDGE 1
+#define INPUT_QUIT 2
+
+/**
+Timer interrupt
+@param fptr - function called when the timer fires, 0 if detached
+@param period - period in microseconds
+@param due - time the timer next fires
+@param repeat - 1 for a Ticker, 0 for a Timeout
+@param used - the timer has been created
+*/
+struct host_timer {
+    void (*fptr)(void);
+    uint64_t period;
+    uint64_t due;
+    int repeat;
+    int used;
+};
+
+/**
+Scripted input event, kept sorted by time
+@param time - time of the event in microseconds
+@param type - INPUT_ANALOG, INPUT_EDGE or INPUT_QUIT
+@param pin - pin the event applies to
+@param value - analogue value or edge direction
+*/
+struct host_input {
+    uint64_t time;
+    int type;
+    int pin;
+    float value;
+};
+
+thread_local host_lcd g_host_lcd;
+
+static thread_local int s_level[HOST_MAX_PINS];
+static thread_local float s_analog[HOST_MAX_PINS];
+static thread_local void (*s_rise[HOST_MAX_PINS])(void);
+static thread_local void (*s_fall[HOST_MAX_PINS])(void);
+static thread_local int s_sce_pin = -1;
+static thread_local int s_dc_pin = -1;
+static thread_local host_timer s_timers[HOST_MAX_TIMERS];
+static thread_local host_input s_inputs[HOST_MAX_INPUTS];
+static thread_local int s_input_count = 0;
+static thread_local int s_input_next = 0;
+static thread_local const char *s_pbm_directory = 0;
+static thread_local int s_terminal = 0;
+static thread_local int s_frame_count = 0;
+static thread_local int s_real_time = 0;
+static thread_local uint64_t s_virtual_now = 0;
+
+static thread_local unsigned int s_rand_seed = 1;
+static thread_local void (*s_sleep_hook)(void) = 0;
+
+// ---------------------------------------------------------------- pins
+
+void host_pin_write(int pin, int value)
+{
+    if (pin >= 0 && pin < HOST_MAX_PINS) {
+        s_level[pin] = value;
+    }
+}
+
+int host_pin_read(int pin)
+{
+    return (pin >= 0 && pin < HOST_MAX_PINS) ? s_level[pin] : 0;
+}
+
+float host_pin_analog(int pin)
+{
+    return (pin >= 0 && pin < HOST_MAX_PINS) ? s_analog[pin] : 0.0f;
+}
+
+void host_pin_attach(int pin, int rising, void (*fptr)(void))
+{
+    if (pin >= 0 && pin < HOST_MAX_PINS) {
+        if (rising) {
+            s_rise[pin] = fptr;
+        } else {
+            s_fall[pin] = fptr;
+        }
+    }
+}
+
+// ---------------------------------------------------------------- display
+
+void host_lcd_connect(int sce_pin, int dc_pin)
+{
+    s_sce_pin = sce_pin;
+    s_dc_pin = dc_pin;
+    for (int i = 0; i < HOST_MAX_PINS; i++) {
+        s_analog[i] = 0.5f;  // joysticks centred until the script moves them
+    }
+}
+
+// decodes a command byte, following the PCD8544 instruction set
+static void lcd_command(unsigned char command)
+{
+    if ((command & 0xF8) == 0x20) {           // function set
+        g_host_lcd.extended = command & 0x01;
+    } else if (g_host_lcd.extended) {
+        return;                               // extended commands only affect the analogue side
+    } else if (command & 0x80) {              // set X address
+        g_host_lcd.x = (command & 0x7F) % HOST_LCD_WIDTH;
+    } else if (command & 0x40) {              // set Y address
+        g_host_lcd.bank = (command & 0x07) % HOST_LCD_BANKS;
+    } else if ((command & 0xF8) == 0x08) {    // display control
+        int inverse = (command & 0x05) == 0x05;
+        if (inverse != g_host_lcd.inverse) {
+            g_host_lcd.inverse = inverse;
+            g_host_lcd.changed = 1;
+        }
+    }
+}
+
+// stores a data byte and advances the address as in horizontal addressing mode
+static void lcd_data(unsigned char data)
+{
+    if (g_host_lcd.ram[g_host_lcd.bank][g_host_lcd.x] != data) {
+        g_host_lcd.ram[g_host_lcd.bank][g_host_lcd.x] = data;
+        g_host_lcd.changed = 1;
+    }
+    if (++g_host_lcd.x == HOST_LCD_WIDTH) {
+        g_host_lcd.x = 0;
+        g_host_lcd.bank = (g_host_lcd.bank + 1) % HOST_LCD_BANKS;
+    }
+}
+
+void host_lcd_write(int value)
+{
+    if (s_sce_pin >= 0 && host_pin_read(s_sce_pin)) {
+        return;  // chip not selected
+    }
+    if (s_dc_pin >= 0 && !host_pin_read(s_dc_pin)) {
+        g_host_lcd.command_bytes++;
+        lcd_command(value);
+    } else {
+        g_host_lcd.data_bytes++;
+        lcd_data(value);
+    }
+}
+
+static int lcd_pixel(int x, int y)
+{
+    int pixel = (g_host_lcd.ram[y/8][x] >> (y%8)) & 1;
+    return g_host_lcd.inverse ? !pixel : pixel;
+}
+
+static void frame_pbm()
+{
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s/frame%05d.pbm", s_pbm_directory, s_frame_count);
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        return;
+    }
+    fprintf(file, "P1\n%d %d\n", HOST_LCD_WIDTH, HOST_LCD_BANKS*8);
+    for (int y = 0; y < HOST_LCD_BANKS*8; y++) {
+        for (int x = 0; x < HOST_LCD_WIDTH; x++) {
+            fputc(lcd_pixel(x, y) ? '1' : '0', file);
+        }
+        fputc('\n', file);
+    }
+    fclose(file);
+}
+
+// prints two rows of pixels per line of text using half blocks
+void host_frame_print()
+{
+    static const char *blocks[4] = {" ", "▀", "▄", "█"};
+    printf("+");
+    for (int x = 0; x < HOST_LCD_WIDTH; x++) {
+        printf("-");
+    }
+    printf("+\n");
+    for (int y = 0; y < HOST_LCD_BANKS*8; y += 2) {
+        printf("|");
+        for (int x = 0; x < HOST_LCD_WIDTH; x++) {
+            printf("%s", blocks[lcd_pixel(x, y) | lcd_pixel(x, y + 1) << 1]);
+        }
+        printf("|\n");
+    }
+    printf("+");
+    for (int x = 0; x < HOST_LCD_WIDTH; x++) {
+        printf("-");
+    }
+    printf("+\n");
+}
+
+void host_frames_pbm(const char *directory)
+{
+    s_pbm_directory = directory;
+}
+
+void host_frames_terminal(int enable)
+{
+    s_terminal = enable;
+}
+
+// outputs the display if it has changed since the last frame
+static void frame_output()
+{
+    if (!g_host_lcd.changed) {
+        return;
+    }
+    g_host_lcd.changed = 0;
+    if (s_pbm_directory) {
+        frame_pbm();
+    }
+    if (s_terminal) {
+        printf("\033[H");  // home the cursor so frames are drawn over each other
+        host_frame_print();
+        fflush(stdout);
+    }
+    s_frame_count++;
+}
+
+// ---------------------------------------------------------------- clock and timers
+
+static uint64_t wall_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t s_epoch = wall_us();
+
+void host_clock_real_time(int enable)
+{
+    s_real_time = enable;
+}
+
+uint64_t host_clock_us()
+{
+    return s_real_time ? wall_us() - s_epoch : s_virtual_now;
+}
+
+uint64_t host_wall_clock_us()
+{
+    return wall_us() - s_epoch;
+}
+
+// moves the clock forward to a time, on the wall clock this means sleeping until then
+static void clock_advance(uint64_t time)
+{
+    if (!s_real_time) {
+        if (time > s_virtual_now) {
+            s_virtual_now = time;
+        }
+        return;
+    }
+    while (host_clock_us() < time) {
+        struct timespec delay = {0, 100000};
+        nanosleep(&delay, 0);
+    }
+}
+
+int host_timer_create()
+{
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        if (!s_timers[i].used) {
+            memset(&s_timers[i], 0, sizeof(host_timer));
+            s_timers[i].used = 1;
+            return i;
+        }
+    }
+    fprintf(stderr, "host: out of timers\n");
+    return 0;
+}
+
+void host_timer_destroy(int id)
+{
+    s_timers[id].used = 0;
+    s_timers[id].fptr = 0;
+}
+
+// as on the board, attaching again restarts the timer from now
+void host_timer_attach(int id, void (*fptr)(void), uint32_t period_us, int repeat)
+{
+    if (period_us == 0) {
+        period_us = 1;  // a zero period would fire for ever without time moving on
+    }
+    s_timers[id].fptr = fptr;
+    s_timers[id].period = period_us;
+    s_timers[id].due = host_clock_us() + period_us;
+    s_timers[id].repeat = repeat;
+}
+
+void host_timer_detach(int id)
+{
+    s_timers[id].fptr = 0;
+}
+
+// ---------------------------------------------------------------- scripted input
+
+static void input_add(uint64_t time_us, int type, int pin, float value)
+{
+    if (s_input_count == HOST_MAX_INPUTS) {
+        fprintf(stderr, "host: too many input events\n");
+        return;
+    }
+    int i = s_input_count++;
+    while (i > s_input_next && s_inputs[i - 1].time > time_us) {  // insertion keeps the list sorted
+        s_inputs[i] = s_inputs[i - 1];
+        i--;
+    }
+    s_inputs[i].time = time_us;
+    s_inputs[i].type = type;
+    s_inputs[i].pin = pin;
+    s_inputs[i].value = value;
+}
+
+void host_input_analog(uint64_t time_us, int pin, float value)
+{
+    input_add(time_us, INPUT_ANALOG, pin, value);
+}
+
+void host_input_edge(uint64_t time_us, int pin, int rising)
+{
+    input_add(time_us, INPUT_EDGE, pin, rising);
+}
+
+void host_input_quit(uint64_t time_us)
+{
+    input_add(time_us, INPUT_QUIT, 0, 0);
+}
+
+static void input_apply(const host_input &input)
+{
+    if (input.type == INPUT_QUIT) {
+        frame_output();
+        throw host_quit();
+    }
+    if (input.type == INPUT_ANALOG) {
+        s_analog[input.pin] = input.value;
+        return;
+    }
+    int rising = input.value != 0;
+    s_level[input.pin] = rising;
+    void (*isr)(void) = rising ? s_rise[input.pin] : s_fall[input.pin];
+    if (isr) {
+        isr();
+    }
+}
+
+void host_sleep_hook(void (*hook)(void))
+{
+    s_sleep_hook = hook;
+}
+
+// ---------------------------------------------------------------- reset
+
+// puts the board back as it was at power-up, so that a thread can play one game after another. Timers stay
+// created, as the game's timer objects last as long as the thread, but none is left attached
+void host_reset()
+{
+    memset(s_level, 0, sizeof(s_level));
+    memset(s_analog, 0, sizeof(s_analog));
+    memset(s_rise, 0, sizeof(s_rise));
+    memset(s_fall, 0, sizeof(s_fall));
+    s_sce_pin = -1;
+    s_dc_pin = -1;
+    memset(&g_host_lcd, 0, sizeof(g_host_lcd));
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        s_timers[i].fptr = 0;
+    }
+    s_input_count = 0;
+    s_input_next = 0;
+    s_frame_count = 0;
+    s_virtual_now = 0;
+    s_rand_seed = 1;
+    s_sleep_hook = 0;
+}
+
+// ---------------------------------------------------------------- random numbers
+
+// the game's rand(), one sequence per thread so that a seed always plays the same game
+int host_rand()
+{
+    return rand_r(&s_rand_seed);
+}
+
+void host_srand(unsigned int seed)
+{
+    s_rand_seed = seed;
+}
+
+// ---------------------------------------------------------------- dispatch
+
+// time of the next timer interrupt or scripted input, UINT64_MAX if there are none
+static uint64_t next_event()
+{
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        if (s_timers[i].used && s_timers[i].fptr && s_timers[i].due < next) {
+            next = s_timers[i].due;
+        }
+    }
+    if (s_input_next < s_input_count && s_inputs[s_input_next].time < next) {
+        next = s_inputs[s_input_next].time;
+    }
+    return next;
+}
+
+// services every interrupt due by now, earliest first, inputs before timers due at the same time
+static void dispatch(uint64_t now)
+{
+    for (;;) {
+        int timer = -1;
+        for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+            if (s_timers[i].used && s_timers[i].fptr && s_timers[i].due <= now &&
+                    (timer < 0 || s_timers[i].due < s_timers[timer].due)) {
+                timer = i;
+            }
+        }
+        if (s_input_next < s_input_count && s_inputs[s_input_next].time <= now &&
+                (timer < 0 || s_inputs[s_input_next].time <= s_timers[timer].due)) {
+            input_apply(s_inputs[s_input_next++]);
+        } else if (timer >= 0) {
+            void (*isr)(void) = s_timers[timer].fptr;
+            if (s_timers[timer].repeat) {
+                s_timers[timer].due += s_timers[timer].period;
+            } else {
+                s_timers[timer].fptr = 0;
+            }
+            isr();
+        } else {
+            return;
+        }
+    }
+}
+
+// the wait keeps servicing interrupts, as it would on the board
+void host_wait_us(uint64_t us)
+{
+    uint64_t end = host_clock_us() + us;
+    for (uint64_t next = next_event(); next <= end; next = next_event()) {
+        clock_advance(next);
+        dispatch(next);
+    }
+    clock_advance(end);
+}
+
+// ---------------------------------------------------------------- sleep
+
+// waits for the next interrupt and services every interrupt that is due
+void host_sleep()
+{
+    frame_output();
+    if (s_sleep_hook) {
+        s_sleep_hook();
+    }
+
+    uint64_t next = next_event();
+    if (next == UINT64_MAX) {
+        fprintf(stderr, "host: sleeping with no interrupts enabled\n");
+        throw host_quit();
+    }
+    clock_advance(next);
+    dispatch(host_clock_us());
+}
@@ -0,0 +1,84 @@
+/**
+@file host_platform.h
+
+@brief Host platform behind the mbed stand-in: pin levels, the PCD8544 display model,
+@brief timer interrupts, the clock and scripted input. The clock is virtual unless
+@brief host_clock_real_time() is called, see host_platform.cpp. Everything here applies to
+@brief the calling thread only, so that games can run side by side on separate threads, and
+@brief host_reset() clears it for the next game on the same thread.
+
+*/
+
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+#include <stdint.h>
+
+#define HOST_LCD_WIDTH 84
+#define HOST_LCD_BANKS 6
+#define HOST_MAX_PINS 32
+#define HOST_MAX_TIMERS 32
+
+// pins
+void host_pin_write(int pin, int value);
+int host_pin_read(int pin);
+float host_pin_analog(int pin);
+void host_pin_attach(int pin, int rising, void (*fptr)(void));
+
+// display model
+void host_lcd_connect(int sce_pin, int dc_pin);
+void host_lcd_write(int value);
+
+/**
+State of the emulated PCD8544 display
+@param ram - display RAM, one byte per column in each bank
+@param x - current column address
+@param bank - current bank address
+@param extended - instruction set selected by the last function set command (H bit)
+@param inverse - inverse video mode is on
+@param data_bytes - number of data bytes received
+@param command_bytes - number of command bytes received
+@param changed - set when the RAM changes, cleared when a frame is output
+*/
+struct host_lcd {
+    unsigned char ram[HOST_LCD_BANKS][HOST_LCD_WIDTH];
+    int x;
+    int bank;
+    int extended;
+    int inverse;
+    unsigned long data_bytes;
+    unsigned long command_bytes;
+    int changed;
+};
+extern thread_local host_lcd g_host_lcd;
+
+// timers and clock
+int host_timer_create();
+void host_timer_destroy(int id);
+void host_timer_attach(int id, void (*fptr)(void), uint32_t period_us, int repeat);
+void host_timer_detach(int id);
+void host_clock_real_time(int enable);
+uint64_t host_clock_us();
+uint64_t host_wall_clock_us();
+void host_wait_us(uint64_t us);
+void host_sleep();
+void host_sleep_hook(void (*hook)(void));
+void host_reset();
+
+// random numbers
+int host_rand();
+void host_srand(unsigned int seed);
+
+// scripted input and frame output
+void host_input_analog(uint64_t time_us, int pin, float value);
+void host_input_edge(uint64_t time_us, int pin, int rising);
+void host_input_quit(uint64_t time_us);
+void host_frames_pbm(const char *directory);
+void host_frames_terminal(int enable);
+void host_frame_print();
+
+/** Thrown from host_sleep() when the script ends the game */
+struct host_quit {
+};
+
+#endif
@@ -0,0 +1,53 @@
+/**
+@file host_script.cpp
+
+@brief Input script reader implementation
+
+*/
+
+#include <cstring>
+#include "mbed.h"
+#include "host_script.h"
+
+int host_script_load(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", filename);
+        return 0;
+    }
+    host_script_read(file, filename);
+    fclose(file);
+    return 1;
+}
+
+// queues the inputs in the script for the calling thread's board
+void host_script_read(FILE *file, const char *name)
+{
+    char line[128];
+    int number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        double ms;
+        char input[16];
+        float value = 0.0f;
+        if (line[0] == '#' || sscanf(line, "%lf %15s %f", &ms, input, &value) < 2) {
+            continue;
+        }
+        uint64_t us = (uint64_t)(ms * 1000.0);
+        if (!strcmp(input, "x")) {
+            host_input_analog(us, PIN_JOYSTICK_X, value);
+        } else if (!strcmp(input, "y")) {
+            host_input_analog(us, PIN_JOYSTICK_Y, value);
+        } else if (!strcmp(input, "pot")) {
+            host_input_analog(us, PIN_POT, value);
+        } else if (!strcmp(input, "press")) {
+            host_input_edge(us, PIN_BUTTON, 1);
+            host_input_edge(us + SCRIPT_PRESS_US, PIN_BUTTON, 0);
+        } else if (!strcmp(input, "quit")) {
+            host_input_quit(us);
+        } else {
+            fprintf(stderr, "%s:%d: unknown input '%s'\n", name, number, input);
+        }
+    }
+}
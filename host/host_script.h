@@ -0,0 +1,34 @@
+/**
+@file host_script.h
+
+@brief Board wiring as seen by the host and the input scripts that drive it.
+
+Script lines have the form "<time in ms> <input> [value]", where input is one of
+    x <0.0-1.0>     joystick x-axis
+    y <0.0-1.0>     joystick y-axis
+    pot <0.0-1.0>   difficulty potentiometer
+    press           press and release the button on the PCB
+    quit            stop the game
+Lines starting with # are ignored.
+
+*/
+
+#ifndef HOST_SCRIPT_H
+#define HOST_SCRIPT_H
+
+#include <cstdio>
+
+// board wiring, as in main.h
+#define PIN_JOYSTICK_X PTB2
+#define PIN_JOYSTICK_Y PTB3
+#define PIN_POT PTB10
+#define PIN_BUTTON PTB18
+#define PIN_LCD_SCE PTA0
+#define PIN_LCD_DC PTD0
+
+#define SCRIPT_PRESS_US 50000   // how long a scripted press holds the button down
+
+int host_script_load(const char *filename);
+void host_script_read(FILE *file, const char *name);
+
+#endif
@@ -0,0 +1,366 @@
+/**
+@file mbed.h
+
+@brief Host stand-in for the mbed library, used to build SPACEGAME as a Linux executable.
+@brief Only the parts of the mbed API used by the game and the N5110 library are provided.
+@brief Pins are backed by the host platform in host_platform.h, which also decodes the SPI
+@brief stream sent to the display and drives the inputs from a script.
+
+*/
+
+#ifndef MBED_H
+#define MBED_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdarg>
+#include <stdint.h>
+
+#include "host_platform.h"
+
+#define MBED_LIBRARY_VERSION 115
+#define DEVICE_SPI_ASYNCH 1
+
+// each thread runs a game of its own, so the game's state and random numbers are per thread
+#define GAME_LOCAL thread_local
+#define rand() host_rand()
+#define srand(seed) host_srand(seed)
+
+/** Pins used on the board. Only their identity matters on the host. */
+enum PinName {
+    PTA0, PTA2,
+    PTB2, PTB3, PTB10, PTB18,
+    PTC2, PTC3, PTC4,
+    PTD0, PTD1, PTD2,
+    PTE26,
+    USBTX, USBRX,
+    NUM_PINS,
+    NC = NUM_PINS
+};
+
+enum PinMode {
+    PullNone,
+    PullDown,
+    PullUp
+};
+
+/** A pointer to a static or member function taking one argument */
+template <typename R, typename A1>
+class FunctionPointerArg1
+{
+public:
+    FunctionPointerArg1(R (*function)(A1) = 0) : _function(function), _object(0), _caller(0) {}
+    template <typename T>
+    FunctionPointerArg1(T *object, R (T::*member)(A1)) : _function(0), _object(object), _caller(&caller<T>) {
+        memcpy(_member, &member, sizeof(member));
+    }
+    R call(A1 a) {
+        return _caller ? _caller(_object, _member, a) : _function(a);
+    }
+private:
+    template <typename T>
+    static R caller(void *object, const char *member, A1 a) {
+        R (T::*m)(A1);
+        memcpy(&m, member, sizeof(m));
+        return (static_cast<T *>(object)->*m)(a);
+    }
+    R (*_function)(A1);
+    void *_object;
+    char _member[2*sizeof(void *)];    // the member function pointer, as the caller knows its type
+    R (*_caller)(void *, const char *, A1);
+};
+
+typedef FunctionPointerArg1<void, int> event_callback_t;
+
+/** Analogue input, reads the value last set by the input script */
+class AnalogIn
+{
+public:
+    AnalogIn(PinName pin) : _pin(pin) {}
+    float read() {
+        return host_pin_analog(_pin);
+    }
+    unsigned short read_u16() {
+        return (unsigned short)(read()*65535.0f);
+    }
+    operator float() {
+        return read();
+    }
+private:
+    PinName _pin;
+};
+
+/** Digital output, the level is stored so that the display model can see DC and SCE */
+class DigitalOut
+{
+public:
+    DigitalOut(PinName pin) : _pin(pin) {}
+    void write(int value) {
+        host_pin_write(_pin, value);
+    }
+    int read() {
+        return host_pin_read(_pin);
+    }
+    DigitalOut& operator= (int value) {
+        write(value);
+        return *this;
+    }
+    operator int() {
+        return read();
+    }
+private:
+    PinName _pin;
+};
+
+/** PWM output, only the duty cycle is kept */
+class PwmOut
+{
+public:
+    PwmOut(PinName pin) : _value(0.0f) {}
+    void write(float value) {
+        _value = value;
+    }
+    float read() {
+        return _value;
+    }
+private:
+    float _value;
+};
+
+/** Digital interrupt input, edges are generated by the input script */
+class InterruptIn
+{
+public:
+    InterruptIn(PinName pin) : _pin(pin) {}
+    void rise(void (*fptr)(void)) {
+        host_pin_attach(_pin, 1, fptr);
+    }
+    void fall(void (*fptr)(void)) {
+        host_pin_attach(_pin, 0, fptr);
+    }
+    void mode(PinMode pull) {}
+    int read() {
+        return host_pin_read(_pin);
+    }
+    operator int() {
+        return read();
+    }
+private:
+    PinName _pin;
+};
+
+#define SPI_EVENT_COMPLETE (1 << 2)
+
+enum DMAUsage {
+    DMA_USAGE_NEVER,
+    DMA_USAGE_OPPORTUNISTIC,
+    DMA_USAGE_ALWAYS
+};
+
+/** SPI master, every byte written is passed to the PCD8544 display model.
+A transfer takes as long as its bytes would on the wire at the set frequency. They reach the model
+when it completes, with DC and SCE as they are then, and the callback is called as the interrupt. */
+class SPI
+{
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) : _hz(1000000), _timer(host_timer_create()), _tx(0), _length(0) {}
+    ~SPI() {
+        host_timer_destroy(_timer);
+    }
+    void format(int bits, int mode = 0) {}
+    void frequency(int hz = 1000000) {
+        _hz = hz;
+    }
+    int write(int value) {
+        host_lcd_write(value);
+        return 0;
+    }
+    int set_dma_usage(DMAUsage usage) {
+        return 0;
+    }
+    template <typename Type>
+    int transfer(const Type *tx_buffer, int tx_length, Type *rx_buffer, int rx_length, const event_callback_t &callback,
+                 int event = SPI_EVENT_COMPLETE) {
+        if (_length) {
+            return -1;      // busy, there is no queue
+        }
+        _tx = (const unsigned char *)tx_buffer;
+        _length = tx_length * sizeof(Type);
+        _callback = callback;
+        transferring() = this;
+        host_timer_attach(_timer, &complete_isr, ((uint64_t)_length * 8 * 1000000 + _hz - 1) / _hz, 0);
+        return 0;
+    }
+    void abort_transfer() {     // the bytes not yet sent never reach the display
+        host_timer_detach(_timer);
+        _length = 0;
+    }
+private:
+    static SPI *&transferring() {   // one transfer at a time on each thread, which is all the display needs
+        static thread_local SPI *spi;
+        return spi;
+    }
+    static void complete_isr() {
+        SPI *spi = transferring();
+        int length = spi->_length;
+        spi->_length = 0;
+        for (int i = 0; i < length; i++) {
+            host_lcd_write(spi->_tx[i]);
+        }
+        spi->_callback.call(SPI_EVENT_COMPLETE);
+    }
+    int _hz;
+    int _timer;
+    const unsigned char *_tx;
+    int _length;
+    event_callback_t _callback;
+};
+
+/** Repeating timer interrupt on the host clock */
+class Ticker
+{
+public:
+    Ticker() : _id(host_timer_create()) {}
+    ~Ticker() {
+        host_timer_destroy(_id);
+    }
+    void attach(void (*fptr)(void), float t) {
+        attach_us(fptr, (uint32_t)(t * 1000000.0f));
+    }
+    void attach_us(void (*fptr)(void), uint32_t t) {
+        host_timer_attach(_id, fptr, t, 1);
+    }
+    void detach() {
+        host_timer_detach(_id);
+    }
+protected:
+    int _id;
+};
+
+/** Single-shot timer interrupt on the host clock */
+class Timeout : public Ticker
+{
+public:
+    void attach(void (*fptr)(void), float t) {
+        attach_us(fptr, (uint32_t)(t * 1000000.0f));
+    }
+    void attach_us(void (*fptr)(void), uint32_t t) {
+        host_timer_attach(_id, fptr, t, 0);
+    }
+};
+
+/** Stopwatch on the host clock */
+class Timer
+{
+public:
+    Timer() : _running(0), _start(0), _time(0) {}
+    void start() {
+        if (!_running) {
+            _start = host_clock_us();
+            _running = 1;
+        }
+    }
+    void stop() {
+        _time += elapsed();
+        _running = 0;
+    }
+    void reset() {
+        _start = host_clock_us();
+        _time = 0;
+    }
+    float read() {
+        return read_us() / 1000000.0f;
+    }
+    int read_ms() {
+        return read_us() / 1000;
+    }
+    int read_us() {
+        return (int)(_time + elapsed());
+    }
+private:
+    uint64_t elapsed() {
+        return _running ? host_clock_us() - _start : 0;
+    }
+    int _running;
+    uint64_t _start;
+    uint64_t _time;
+};
+
+/** Serial port, mapped to the standard output */
+class Serial
+{
+public:
+    Serial(PinName tx, PinName rx) {}
+    void baud(int baudrate) {}
+    int printf(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    int putc(int c) {
+        return fputc(c, stdout);
+    }
+    int getc() {
+        return fgetc(stdin);
+    }
+    int readable() {
+        return 0;
+    }
+    int writeable() {
+        return 1;
+    }
+};
+
+inline void wait_us(int us)
+{
+    host_wait_us(us);
+}
+
+inline void wait_ms(int ms)
+{
+    host_wait_us((uint64_t)ms * 1000);
+}
+
+inline void wait(float s)
+{
+    host_wait_us((uint64_t)(s * 1000000.0f));
+}
+
+inline void sleep()
+{
+    host_sleep();
+}
+
+inline void deepsleep()     // nothing to power down, wakes as sleep() does
+{
+    host_sleep();
+}
+
+inline uint32_t us_ticker_read()
+{
+    return (uint32_t)host_clock_us();
+}
+
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+inline uint32_t __get_PRIMASK() { return 0; }
+inline void __set_PRIMASK(uint32_t mask) {}
+inline void __WFI()     // interrupts are never masked on the host, so they run while it waits
+{
+    host_sleep();
+}
+
+inline void error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    exit(1);
+}
+
+#endif
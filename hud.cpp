@@ -0,0 +1,77 @@
+/**
+@file hud.cpp
+
+@brief Retained heads-up display implementation
+
+*/
+
+#include "mbed.h"
+#include "N5110.h"
+#include "hud.h"
+#include "profile.h"
+
+void hud_init(hud *h)
+{
+    h->score.x = HUD_SCORE_X;
+    h->score.label = "Sc:";
+    h->score.digits = HUD_SCORE_DIGITS;
+    h->lives.x = HUD_LIVES_X;
+    h->lives.label = "Lives:";
+    h->lives.digits = HUD_LIVES_DIGITS;
+    hud_invalidate(h);
+}
+
+void hud_invalidate(hud *h)
+{
+    h->score.width = 0;
+    h->lives.width = 0;
+    h->boundary = 0;
+}
+
+// draws a counter if its value has changed or it needs drawing
+static void hud_counter_update(hud_counter *c, N5110 *lcd, int value)
+{
+    if (c->width > 0 && value == c->shown) {
+        return;
+    }
+
+    int x = c->x;
+    if (c->width == 0) {                    // label only needs drawing after the screen was cleared
+        lcd->printString(c->label, x, 0);
+    }
+    x += strlen(c->label) * HUD_CHAR_WIDTH;
+
+    // work out the digits from the right, as sprintf's %*d would
+    char digits[12];
+    int n = 0;
+    unsigned int magnitude = (value < 0) ? -value : value;
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[n++] = '-';
+    }
+
+    int width = (n > c->digits) ? n : c->digits;
+    int blank = (c->width > width) ? c->width : width;  // blank out any digits left over from a longer number
+    for (int i = 0; i < blank; i++) {
+        int place = width - 1 - i;                      // position counted from the right of the number
+        char glyph = (i < width && place < n) ? digits[place] : ' ';
+        lcd->printChar(glyph, x + i * HUD_CHAR_WIDTH, 0);
+    }
+
+    c->shown = value;
+    c->width = width;
+}
+
+void hud_update(hud *h, N5110 *lcd, int score, int lives)
+{
+    PROFILE_ZONE(PROFILE_HUD);
+    hud_counter_update(&h->score, lcd, score);
+    hud_counter_update(&h->lives, lcd, lives);
+    if (!h->boundary) {
+        lcd->drawLine(0, HUD_BOUNDARY_Y, WIDTH - 1, HUD_BOUNDARY_Y, 1);  // display boundary
+        h->boundary = 1;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+@file hud.h
+@brief Retained heads-up display for SPACEGAME: the score, the lives and the boundary below them.
+@brief Each part is only drawn again when the value it shows changes, or after the screen has been cleared.
+@brief Numbers are turned into glyphs directly rather than through sprintf, and all text is in bank 0.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef HUD_H
+#define HUD_H
+
+#include "N5110.h"
+
+#define HUD_SCORE_X 0       /*!< Column of the score label */
+#define HUD_SCORE_DIGITS 3  /*!< Minimum width of the score, wider scores push into the space before the lives */
+#define HUD_LIVES_X 42      /*!< Column of the lives label */
+#define HUD_LIVES_DIGITS 1  /*!< Minimum width of the lives */
+#define HUD_BOUNDARY_Y 8    /*!< Row of the line separating the display from the play area */
+#define HUD_CHAR_WIDTH 6    /*!< Each character is 5 pixels wide plus a space */
+
+/**
+A number shown on the display after a label
+@param x - column of the label
+@param label - text before the number
+@param digits - minimum width of the number in characters, padded with spaces on the left as with printf's %*d
+@param shown - number currently on the display
+@param width - number of characters currently used by the number, 0 if it needs drawing
+*/
+struct hud_counter {
+    int x;
+    const char *label;
+    int digits;
+    int shown;
+    int width;
+};
+
+/**
+The heads-up display
+@param score - score counter
+@param lives - lives counter
+@param boundary - 1 once the boundary line has been drawn
+*/
+struct hud {
+    hud_counter score;
+    hud_counter lives;
+    int boundary;
+};
+
+/**
+Initialises the heads-up display, nothing is drawn until hud_update() is called
+@param h - the display
+*/
+void hud_init(hud *h);
+
+/**
+Marks every part of the heads-up display as needing to be drawn, for when the screen has been cleared
+@param h - the display
+*/
+void hud_invalidate(hud *h);
+
+/**
+Draws the parts of the heads-up display that have changed into the LCD's buffer
+@param h - the display
+@param lcd - the LCD to draw on, the changes are sent at its next refresh
+@param score - score to show
+@param lives - lives to show
+*/
+void hud_update(hud *h, N5110 *lcd, int score, int lives);
+
+#endif
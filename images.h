@@ -0,0 +1,37 @@
+/**
+@file images.h
+@brief The images of SPACEGAME, and the sprites packed from them at compile time.
+@brief They are kept apart from main.h so that the host's benchmarks can test collisions against the game's own sprites.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef IMAGES_H
+#define IMAGES_H
+
+#include "sprite.h"
+
+constexpr image spaceship[] = {0,0,-3,-3,-2,-2,-1,-2,-2,-1,-1,-1,-1,0,-1,1,-1,2,-2,1,
+                        -2,2,-1,2,-3,3,0,-1,0,1,1,0,1,-1,1,1,2,0,3,0,99};         /*!< The image of the spaceship */
+constexpr image asteroid[] = {0,0,-1,-1,0,-1,0,-2,1,-1,1,0,2,0,-1,1,0,1,0,1,1,1,1,2,99};    /*!< The image of the asteroids */
+constexpr image enemy_spaceship[] = {0,0,0,1,0,-1,1,-2,1,2,-1,0,99};                        /*!< The image of the enemy spaceships */
+constexpr image boss1[] = {2,-4, 3,-4, 4,-4,
+                 -1,-3, 0,-3, 1,-3, 2,-3, 3,-3,
+                 -3,-2, -2,-2, -1,-2, 0,-2, 1,-2, 2,-2, 3,-2, 4,-2, 5,-2,
+                 -5,-1, -4,-1, -3,-1, -2,-1, -1,-1, 0,-1, 1,-1, 2,-1, 3,-1,
+                 -6,0, -5,0, -4,0, -3,0, -2,0, -1,0, 0,0, 1,0, 2,0, 3,0, 4,0,
+                 -5,1, -4,1, -3,1, -2,1, -1,1, 0,1, 1,1, 2,1, 3,1,
+                 -3,2, -2,2, -1,2, 0,2, 1,2, 2,2, 3,2, 4,2, 5,2,
+                 -1,3, 0,3, 1,3, 2,3, 3,3,
+                 2,4, 3,4, 4,4, 99};                                              /*!< The image of the boss */
+constexpr image point[] = {0,0,99};                                                   /*!< A single pixel, how a bullet hits each part of the boss */
+constexpr image boss_guns[] = {2,-4, -1,-3, -4,-2, -5,-1, -6,0, -5,1, -4,2, -1,3, 2,4, 99}; /*!< Used to make bullets fire from the correct positions on the boss */
+
+SPRITE(spaceship_sprite, spaceship);               /*!< The spaceship, packed for drawing */
+SPRITE(asteroid_sprite, asteroid);                 /*!< The asteroids, packed for drawing */
+SPRITE(enemy_spaceship_sprite, enemy_spaceship);   /*!< The enemy spaceships, packed for drawing */
+SPRITE(boss1_sprite, boss1);                       /*!< The boss, packed for drawing */
+SPRITE(point_sprite, point);                       /*!< A single pixel, packed for collisions */
+
+#endif
@@ -0,0 +1,103 @@
+/**
+@file isr_queue.h
+@brief Queue of events from interrupt service routines to the main loop of SPACEGAME, which pops them without locking.
+@brief There are several producers, the scheduler's tick interrupt and the button's edge interrupt, which need not
+@brief share a priority, and the main loop standing in for the button. A push holds interrupts off for its few
+@brief stores so that one producer can't take the slot another is filling, and puts back the mask it found, so a
+@brief push from code that already holds them off leaves them off. There is one consumer, the main loop, which is
+@brief the only side to write the tail and never has to turn interrupts off. An event is written into its slot
+@brief before the head is moved past it, so the main loop never sees a half-written event. When the queue is full
+@brief the new event is dropped and counted, rather than overwriting one the main loop hasn't seen, as mbed's
+@brief CircularBuffer would. A push is a handful of loads and stores with no loops or calls, so it is cheap enough
+@brief for any interrupt.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef ISR_QUEUE_H
+#define ISR_QUEUE_H
+
+#include <stdint.h>
+#include "mbed.h"
+
+#define ISR_QUEUE_SIZE 32   /*!< Events the queue holds, a power of two so the indices wrap with a mask */
+#define ISR_BUTTON 0        /*!< The button on the PCB changed, the data is its new level */
+#define ISR_TIMER 1         /*!< A scheduler task fell due, the data is the task's number */
+
+#define ISR_QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")  /*!< Stops the compiler moving memory accesses across it */
+
+/**
+An event
+@param type - ISR_BUTTON or ISR_TIMER
+@param data - depends on the type
+@param time_us - when it happened, in microseconds from us_ticker_read()
+*/
+struct isr_event {
+    uint8_t type;
+    uint8_t data;
+    uint32_t time_us;
+};
+
+/**
+The queue, both indices count on past the size and wrap with it
+@param events - the slots
+@param head - events pushed, written only by a push
+@param tail - events popped, written only by the main loop
+@param overflows - events dropped because the queue was full
+*/
+struct isr_queue {
+    isr_event events[ISR_QUEUE_SIZE];
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    volatile unsigned int overflows;
+};
+
+/**
+Adds an event, called from an interrupt or with interrupts held off
+@param q - the queue
+@param type - ISR_BUTTON or ISR_TIMER
+@param data - depends on the type
+@param time_us - when it happened
+@returns 1 if it was added, 0 if the queue was full
+*/
+inline int isr_queue_push(isr_queue *q, int type, int data, uint32_t time_us)
+{
+    uint32_t mask = __get_PRIMASK();
+    __disable_irq();        // a higher priority producer can't take this slot while it is filled
+    unsigned int head = q->head;
+    if (head - q->tail == ISR_QUEUE_SIZE) {
+        q->overflows++;
+        __set_PRIMASK(mask);
+        return 0;
+    }
+    isr_event *e = &q->events[head & (ISR_QUEUE_SIZE - 1)];
+    e->type = type;
+    e->data = data;
+    e->time_us = time_us;
+    ISR_QUEUE_BARRIER();    // the event is complete before the main loop can see it
+    q->head = head + 1;
+    __set_PRIMASK(mask);
+    return 1;
+}
+
+/**
+Takes the oldest event, called from the main loop
+@param q - the queue
+@param e - filled with the event
+@returns 1 if there was an event, 0 if the queue was empty
+*/
+inline int isr_queue_pop(isr_queue *q, isr_event *e)
+{
+    unsigned int tail = q->tail;
+    if (tail == q->head) {
+        return 0;
+    }
+    ISR_QUEUE_BARRIER();
+    *e = q->events[tail & (ISR_QUEUE_SIZE - 1)];
+    ISR_QUEUE_BARRIER();    // the slot has been read before the interrupts can reuse it
+    q->tail = tail + 1;
+    return 1;
+}
+
+#endif
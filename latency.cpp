@@ -0,0 +1,203 @@
+/**
+@file latency.cpp
+
+@brief Input latency tracing implementation
+
+*/
+
+#include "mbed.h"
+#include "scheduler.h"
+#include "latency.h"
+
+/**
+A trace in flight
+@param id - the trace's ID, 0 while the slot is free
+@param kind - LATENCY_FIRE or LATENCY_MOVE
+@param stage - the last stage reached, LATENCY_SENT is written by the SPI interrupt
+@param queued - 1 once the frame it was drawn into has been started
+@param time_us - when each stage was reached
+*/
+struct latency_trace {
+    uint16_t id;
+    uint8_t kind;
+    volatile uint8_t stage;
+    volatile uint8_t queued;
+    uint32_t time_us[LATENCY_STAGES];
+};
+
+/**
+The traces and their results
+@param traces - the traces in flight
+@param next_id - ID of the last trace begun
+@param histogram - times from the input to each stage after it
+@param max_us - the longest of each
+@param completed - traces that reached the display
+@param given_up - traces replaced by a later input before they were drawn
+@param lost - traces not begun because too many were in flight
+*/
+struct latency {
+    latency_trace traces[LATENCY_TRACES];
+    uint16_t next_id;
+    uint32_t histogram[LATENCY_KINDS][LATENCY_STAGES - 1][LATENCY_BUCKETS];
+    uint32_t max_us[LATENCY_KINDS][LATENCY_STAGES - 1];
+    unsigned int completed[LATENCY_KINDS];
+    unsigned int given_up[LATENCY_KINDS];
+    unsigned int lost[LATENCY_KINDS];
+};
+
+static GAME_LOCAL latency s_latency;
+
+static const char *const kind_names[LATENCY_KINDS] = {"fire", "move"};
+static const char *const stage_names[LATENCY_STAGES] = {"input", "handled", "drawn", "sent"};
+
+void latency_init()
+{
+    memset(&s_latency, 0, sizeof(s_latency));
+}
+
+uint16_t latency_begin(int kind, uint32_t time_us)
+{
+    latency *l = &s_latency;
+    latency_trace *slot = NULL;
+
+    for (int i = 0; i < LATENCY_TRACES; i++) {
+        latency_trace *t = &l->traces[i];
+        if (t->id != 0 && t->kind == kind && t->stage < LATENCY_DRAWN) {    // only the latest of a kind is followed
+            l->given_up[kind]++;
+            slot = t;
+            break;
+        }
+        if (t->id == 0 && slot == NULL) {
+            slot = t;
+        }
+    }
+    if (slot == NULL) {
+        l->lost[kind]++;
+        return 0;
+    }
+    if (++l->next_id == 0) {
+        l->next_id = 1;
+    }
+    slot->id = l->next_id;
+    slot->kind = kind;
+    slot->stage = 0;
+    slot->queued = 0;
+    slot->time_us[0] = time_us;
+    return slot->id;
+}
+
+void latency_mark(uint16_t id, int stage)
+{
+    if (id == 0) {
+        return;
+    }
+    for (int i = 0; i < LATENCY_TRACES; i++) {
+        latency_trace *t = &s_latency.traces[i];
+        if (t->id == id) {
+            if (t->stage == stage - 1) {
+                t->time_us[stage] = us_ticker_read();
+                t->stage = stage;
+            }
+            return;
+        }
+    }
+}
+
+// below 8 us each bucket is a microsecond, above that each power of two is split into eight
+static int bucket(uint32_t us)
+{
+    if (us < 8) {
+        return us;
+    }
+    int power = 31 - __builtin_clz(us);
+    int b = (power - 2)*8 + ((us >> (power - 3)) & 7);
+    return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+}
+
+// the shortest time past a bucket
+static uint32_t bucket_end(int b)
+{
+    if (b < 8) {
+        return b + 1;
+    }
+    return (uint32_t)(8 + b % 8 + 1) << (b / 8 - 1);
+}
+
+static void record(latency_trace *t)
+{
+    latency *l = &s_latency;
+    for (int stage = 1; stage < LATENCY_STAGES; stage++) {
+        uint32_t us = t->time_us[stage] - t->time_us[0];
+        l->histogram[t->kind][stage - 1][bucket(us)]++;
+        if (us > l->max_us[t->kind][stage - 1]) {
+            l->max_us[t->kind][stage - 1] = us;
+        }
+    }
+    l->completed[t->kind]++;
+    t->id = 0;
+}
+
+// no frame is in flight when this is called, so the next to reach the display is the one about to be started,
+// and a trace queued here is sent with it
+void latency_frame()
+{
+    latency *l = &s_latency;
+    for (int i = 0; i < LATENCY_TRACES; i++) {
+        latency_trace *t = &l->traces[i];
+        if (t->id == 0) {
+            continue;
+        }
+        if (t->stage == LATENCY_SENT) {
+            record(t);
+        } else if (t->stage == LATENCY_DRAWN) {
+            t->queued = 1;
+        }
+    }
+}
+
+// the main loop only changes the traces this looks at while no frame is in flight, so the two never race
+void latency_frame_sent()
+{
+    uint32_t now = us_ticker_read();
+    for (int i = 0; i < LATENCY_TRACES; i++) {
+        latency_trace *t = &s_latency.traces[i];
+        if (t->id != 0 && t->queued && t->stage == LATENCY_DRAWN) {
+            t->time_us[LATENCY_SENT] = now;
+            t->stage = LATENCY_SENT;
+        }
+    }
+}
+
+// the end of the bucket holding the given fraction of the times, or the longest time if that is sooner
+static uint32_t percentile_us(const uint32_t *histogram, uint32_t max_us, unsigned int count, int percent)
+{
+    uint32_t wanted = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen >= wanted) {
+            uint32_t end = bucket_end(b);
+            return end <= max_us ? end : max_us;
+        }
+    }
+    return max_us;
+}
+
+void latency_print_stats()
+{
+    const latency *l = &s_latency;
+    for (int kind = 0; kind < LATENCY_KINDS; kind++) {
+        printf("latency: %s %u traced, %u given up, %u lost\r\n", kind_names[kind], l->completed[kind],
+               l->given_up[kind], l->lost[kind]);
+        if (l->completed[kind] == 0) {
+            continue;
+        }
+        for (int stage = 1; stage < LATENCY_STAGES; stage++) {
+            const uint32_t *h = l->histogram[kind][stage - 1];
+            uint32_t max_us = l->max_us[kind][stage - 1];
+            printf("latency: %s to %-7s p50 %7u us, p99 %7u us, max %7u us\r\n", kind_names[kind], stage_names[stage],
+                   (unsigned int)percentile_us(h, max_us, l->completed[kind], 50),
+                   (unsigned int)percentile_us(h, max_us, l->completed[kind], 99), (unsigned int)max_us);
+        }
+    }
+}
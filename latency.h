@@ -0,0 +1,73 @@
+/**
+@file latency.h
+@brief Measures the time from an input of SPACEGAME to its effect reaching the display.
+@brief Each input that should change the display begins a trace with an ID, which the game carries with it and
+@brief marks at each stage: handled by the game logic, drawn into the framebuffer, and sent to the display when the
+@brief SPI transfer of the frame holding it completes. The time from the input to each stage is kept in a histogram
+@brief for each kind of input, from which the median and 99th percentile are printed at the end of the game. The
+@brief buckets widen with the time, so that each is within an eighth of the times it counts.
+@brief A trace is a few stores at each stage, so tracing is always on. Times come from us_ticker_read(), which on
+@brief the host is the simulated clock, so a scripted run gives the same figures every time.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#define LATENCY_FIRE 0          /*!< The button pressed, until the bullet is on the display */
+#define LATENCY_MOVE 1          /*!< The joystick moved, until the ship is redrawn where it moved to */
+#define LATENCY_KINDS 2
+
+#define LATENCY_HANDLED 1       /*!< The game logic has acted on the input */
+#define LATENCY_DRAWN 2         /*!< The result has been drawn into the framebuffer */
+#define LATENCY_SENT 3          /*!< The frame holding it has been sent to the display */
+#define LATENCY_STAGES 4        /*!< Including the input itself, stage 0 */
+
+#define LATENCY_TRACES 8        /*!< Traces in flight at once */
+#define LATENCY_BUCKETS 160     /*!< Buckets in each histogram, eight to each power of two microseconds up to 4 s */
+
+/**
+Empties the histograms and drops any traces in flight, called once before the game starts
+*/
+void latency_init();
+
+/**
+Begins a trace. A trace of the same kind that hasn't been drawn yet is given up, as the game carries one ID
+for each kind and only the latest input is followed.
+@param kind - LATENCY_FIRE or LATENCY_MOVE
+@param time_us - when the input happened, from us_ticker_read()
+@returns the trace's ID, or 0 if LATENCY_TRACES are already in flight
+*/
+uint16_t latency_begin(int kind, uint32_t time_us);
+
+/**
+Marks a trace as having reached a stage. Marks out of order, and marks for a trace that is already complete or
+was given up, are ignored, so the game can mark a stage each time it might have been reached.
+@param id - the trace's ID, 0 is ignored
+@param stage - LATENCY_HANDLED or LATENCY_DRAWN
+*/
+void latency_mark(uint16_t id, int stage);
+
+/**
+Takes the traces drawn so far into the frame about to be sent, called by the main loop just before it refreshes
+the display and once the last frame has been sent, so that the next frame to finish is the one holding them.
+Also completes the traces in frames that have been sent since the last call.
+*/
+void latency_frame();
+
+/**
+Notes that a frame has been sent, for N5110::attachRefresh(). Called from the SPI interrupt where the transfer is
+asynchronous, so it only notes the time in the traces sent with it.
+*/
+void latency_frame_sent();
+
+/**
+Prints the median and 99th percentile of the time from the input to each stage, for each kind of input
+*/
+void latency_print_stats();
+
+#endif
@@ -7,449 +7,630 @@ Geoff Grevers
 
 */
 
+#include <math.h>
 #include "mbed.h"
 #include "N5110.h"
+#include "sprite.h"
+#include "images.h"
+#include "hud.h"
+#include "scheduler.h"
+#include "projectile.h"
+#include "entity.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "game.h"
+#include "snapshot.h"
+#include "flash_store.h"
+#include "replay.h"
+#include "prng.h"
+#include "wheel.h"
+#include "sampler.h"
+#include "latency.h"
+#include "profile.h"
 #include "main.h"
 
-DigitalOut buzzer(PTA2);
+GAME_LOCAL DigitalOut buzzer(PTA2);
+
+GAME_LOCAL Serial pc(USBTX, USBRX);     // USB serial port, typing p on it prints the profile
+
+#if RECORD_INPUT == 1
+static int record_sink(const unsigned char *data, int length)   // as much as the UART will take without waiting
+{
+    int n = 0;
+    while (n < length && pc.writeable()) {
+        pc.putc(data[n++]);
+    }
+    return n;
+}
+#elif RECORD_INPUT == 2
+LocalFileSystem local("local");
+static FILE *s_record_file;
+
+static int record_sink(const unsigned char *data, int length)
+{
+    return fwrite(data, 1, length, s_record_file);
+}
+#endif
 
 int main()
 {
+    game *g = &g_game;
+
     led = 1;                                        // initialise led, remains green until on last life
-    switch_external.fall(&switch_external_isr);     // initialising switch on PCB, calls on falling edge of input
+    profile_init();
+    latency_init();
     switch_external.mode(PullDown);                 // input pin mode parameter for PCB switch
+    hud_init(&g->heads_up);                         // score, lives and boundary are drawn the first time round the loop
+    projectile_init(&g->bullets);
+    broad_clear(&g->enemy_index);                   // no enemy covers any columns yet, before the first sleep below
     lcd.init();                                     // initialising LCD display
     lcd.clear();
-    ticker_fsm.attach(&timer_isr_fsm, 0.2);
-    g_state = START_STATE;      // define FSM state
-    g_alive = 1;                // define alive state
-    g_number_lives = 3;         // number of lives
+    lcd.attachRefresh(&latency_frame_sent);         // times each frame reaching the display
+    sched_init(&g->sched, g);                       // every task is given the game
+    sched_report(&g->events);
+    sampler_init(&pot_x, &pot_y, &pot, &switch_external, &g->events);    // joystick and pot sampled in the background, button debounced
+    g->button = switch_external.read();
+    g->task_ship = sched_add(&shipcontrol);         // tasks run in this order when several are due together
+    g->task_fsm = sched_add(&fsm_step);
+    g->task_fire = sched_add(&shoot);
+    g->task_bullet = sched_add(&move_bullets);
+    g->input_tick = g->sched.ticks - 1;              // the inputs are read on the first pass
+    wheel_clear(&g->timers, g->input_tick);
+
+    int length;
+    const unsigned char *saved = flash_store_read(&length);
+    if (saved && snapshot_restore(g, &lcd, saved, length)) {     // carry on with the game suspended before power-down
+        flash_store_erase();     // a suspended game is only resumed once
+        PROFILE_ZONE(PROFILE_REFRESH);
+        lcd.refresh();
+    } else {
+        sched_start(g->task_fsm, sched_ticks(0.2));
+        g->state = START_STATE;      // define FSM state
+        g->alive = 1;                // define alive state
+        g->number_lives = 3;         // number of lives
+#if RECORD_INPUT == 2
+        s_record_file = fopen("/local/input.rec", "wb");
+        if (s_record_file && !replay_active()) {
+            replay_record(&record_sink);
+        }
+#elif RECORD_INPUT
+        if (!replay_active()) {
+            replay_record(&record_sink);
+        }
+#endif
+        prng_seed(&g->random, replay_seed(prng_entropy()));     // a replay gives the recorded seed
+    }
 
-    while(g_alive != 2)    {
+    while(g->alive != 2)    {
 
-        length_score = sprintf(buffer_score,"Sc:%3d",g_score);          // print formatted data to buffer
-        if (length_score <= 14) {                                       // is string fits on display
-            lcd.printString(buffer_score,0,0);                          // display on screen
+        drain_events(g);
+        if (g->sched.ticks != g->input_tick) {      // once each tick taken, so a replay sees the inputs on the same ticks
+            g->input_tick = g->sched.ticks;
+            profile_tick();
+            read_inputs(g);
+            run_timers(g);          // enemies appearing and firing
         }
-        length_lives = sprintf(buffer_lives,"Lives:%1d",g_number_lives);    // print formatted data to buffer
-        if (length_lives <= 7) {                                            // is string fits on display (7 from 42 pixels / 6 pixels per char)
-            lcd.printString(buffer_lives,42,0);                             // display on screen
-        }
-        lcd.drawLine(0, 8, WIDTH - 1, 8, 1);                           // display boundary
+        hud_update(&g->heads_up, &lcd, g->score, g->number_lives);             // redraws the score and lives only when they change
 
-        if (g_timer_flag_ship == 1) {           // used for controlling the ship
-            shipcontrol();
-            g_timer_flag_ship = 0;              //reset flag
+        sched_run();        // ship, FSM and bullets, whichever are due
+        unsigned int due;
+        if (wheel_next(&g->timers, &due)) {
+            sched_wake(due);        // the ticks enemies appear and fire on are taken, even when no task is due
         }
-        if (g_timer_flag_fsm == 1) {            // used for timing in states
-            g_timer_flag_fsm = 0;               // reset flag
-            (*state[g_state].function)();       // calls the function needed for that state
-            ticker_fsm.attach (&timer_isr_fsm,state[g_state].time);       // timing during states
+        if (replay_next_tick(&due)) {
+            sched_wake(due);        // as are the ticks a replay's inputs change on
         }
-        if (g_switch_external_flag || g_timer_flag_bullet) {              // controls movement of bullet across screen
-            g_switch_external_flag = 0;         // reset flag
-            g_timer_flag_bullet = 0;            // reset flag
-            shoot();                            // calls the shoot routine
+        if (g->number_lives < 1 && g->alive == 0) {       // is he out of lives and dead?
+            g->alive = 2;                                // end while loop and display endscreen
         }
-        if (state[g_state].shoot_ability == 1 && g_timer_flag_enemy_bullet) {   // controls whether the enemy can shoot or not
-            g_timer_flag_enemy_bullet = 0;                                      // by reseting the flag and
-            enemy_shoot();                                                      // calling the enemy_shoot routine
+        if (g->new_state == 1) {                             // controls moving to the next state in the FSM
+            g->state = state[g->state].nextState[g->alive];    // calls the next state in the FSM
+            g->new_state  = 0;                               // resets the flag
+            g->firsttime = 0;
+            wheel_clear(&g->timers, g->input_tick);          // enemies of the last state stop appearing and firing
         }
-        if (g_number_lives < 1 && g_alive == 0) {       // is he out of lives and dead?
-            g_alive = 2;                                // end while loop and display endscreen
+        if (g->number_lives > 0 && g->alive == 0) {       // dies but lives are remaining
+            g->alive = 1;                                // reset flag
         }
-        if (g_new_state == 1) {                             // controls moving to the next state in the FSM
-            g_state = state[g_state].nextState[g_alive];    // calls the next state in the FSM
-            g_new_state  = 0;                               // resets the flag
-            firsttime = 0;
+        if (g->number_lives == 1) {      // turn on red LED when on last life
+            led = 0;
         }
-        if (g_number_lives > 0 && g_alive == 0) {       // dies but lives are remaining
-            g_alive = 1;                                // reset flag
+        if (g->input.button) {      // holding the button down suspends the game
+            if (!g->button_held) {
+                g->button_held = 1;
+                g->held_since = g->sched.ticks;
+            } else if ((int)(g->sched.ticks - g->held_since) >= sched_ticks(SUSPEND_HOLD)) {
+                unsigned char blob[SNAPSHOT_MAX_BYTES];     // only taken from the stack while the game is saved
+                suspend(g, blob, sizeof(blob));
+                g->held_since = g->sched.ticks;     // only returns if the game couldn't be saved, try again after another hold
+            }
+        } else {
+            g->button_held = 0;
+            g->held_since = 0;
         }
-        if (g_number_lives == 1) {      // turn on red LED when on last life
-            led = 0;
+        lcd.waitForRefresh();   // the last frame has gone, so the traces drawn since are in the next
+        latency_frame();
+        {
+            PROFILE_ZONE(PROFILE_REFRESH);
+            lcd.refreshAsync();     // present everything drawn this time round the loop in one frame
+        }
+        replay_drain();
+#if PROFILE
+        if (pc.readable() && pc.getc() == 'p') {
+            profile_dump();
         }
+#endif
         sleep();        // saves power
     }
-    endscreen();        // game over screen showing score
+    endscreen(g);       // game over screen showing score
+    replay_close(g->sched.ticks);
+#if RECORD_INPUT == 2
+    if (s_record_file) {
+        fclose(s_record_file);
+    }
+#endif
+    sched_print_stats();
+    printf("events: %u tasks due, waited %u us on average and %u us at most, %u lost, %u button bounces\r\n",
+           g->timer_events, g->timer_events ? g->wait_total_us / g->timer_events : 0, g->wait_max_us, g->events.overflows,
+           sampler_bounces());
+    latency_print_stats();
+    profile_dump();
+    replay_print_stats();
+    printf("bullets: %d at most in flight, %d dropped\r\n", g->bullets.high_water, g->bullets.dropped);
+    return 0;
 }
 
+void read_inputs(game *g)
+{
+    input_state *in = &g->input;
+    int dx = in->dx, dy = in->dy;
+    sampler_state s;
+    sampler_read(&s);
+    in->dx = (s.x > 0) - (s.x < 0);     // the joystick only moves the ship when it's out of the dead-zone
+    in->dy = (s.y > 0) - (s.y < 0);
+    in->speed = sched_ticks((float)s.pot / SAMPLER_FULL_SCALE);    // potentiometer controls the ships speed, as a form of difficulty setting
+    in->button = g->button;
+    in->fire = g->presses > 0;
+    g->presses = 0;
+    replay_input(in, g->input_tick);
+    if ((in->dx != dx || in->dy != dy) && (in->dx || in->dy)) {     // the joystick has moved off centre or to a new direction
+        g->move_trace = latency_begin(LATENCY_MOVE, us_ticker_read());
+    }
+    if (in->fire) {
+        sched_trigger(g->task_fire);    // fire on this pass of the main loop
+    }
+}
 
-void start()    // setting up starting conditions
+void drain_events(game *g)
 {
-    int i;
-    ship_x = SHIP_OFFSET + 1;           // initial ship position x axis
-    ship_y = HEIGHT/2;                  // initial ship position y axis
-    ticker_ship.detach();
-    ticker_fsm.attach (&timer_isr_fsm, 5.0);
+    isr_event e;
+
+    while (isr_queue_pop(&g->events, &e)) {
+        if (e.type == ISR_BUTTON) {
+            if (!e.data) {      // fires on the falling edge, as it always has
+                g->presses++;
+                g->fire_trace = latency_begin(LATENCY_FIRE, e.time_us);
+            }
+            g->button = e.data;
+            sched_wake(g->sched.ticks + 1);     // the inputs are read on the next tick, whatever is due
+        } else {
+            uint32_t wait = us_ticker_read() - e.time_us;
+            g->timer_events++;
+            g->wait_total_us += wait;
+            if (wait > g->wait_max_us) {
+                g->wait_max_us = wait;
+            }
+        }
+    }
+}
+
+void suspend(game *g, unsigned char *blob, int size)
+{
+    int length = snapshot_save(g, &lcd, blob, size);
+    if (length == 0 || !flash_store_write(blob, length)) {
+        return;
+    }
+    replay_close(g->sched.ticks);      // a resumed game isn't recorded
+    led = 1;
+    lcd.turnOff();
+    for (;;) {
+        deepsleep();    // until reset, main() then finds the game in flash
+    }
+}
+
+void fsm_step(void *context)
+{
+    game *g = (game *)context;
+
+    (*state[g->state].function)(g);                               // calls the function needed for that state
+    sched_start(g->task_fsm, sched_ticks(state[g->state].time));  // timing during states
+}
+
+
+void start(game *g)     // setting up starting conditions
+{
+    g->ship_x = SHIP_OFFSET + 1;           // initial ship position x axis
+    g->ship_y = HEIGHT/2;                  // initial ship position y axis
+    sched_stop(g->task_ship);
+    sched_stop(g->task_bullet);
+    projectile_clear(&g->bullets);       // any bullets in flight went with the screen
     lcd.clear();
-    paint_character(ship_x, ship_y, spaceship, SET);
-    g_new_state = 1;        // move to next state once initial conditions are set
-    lcd.refresh();
-    ticker_ship.attach(&timer_isr_ship, 0.1);
-    g_no_of_obj = 0;        // no enemies currently
-    for (i = 0; i < state[g_state].total_objects; i++) {
-        enemy_array[i].iteration = 0;          // the iteration has to match or be greater than the other to make the enemy be displayed 
-        enemy_array[i].x = 0;
-        enemy_array[i].y = 0;                  // spits out enemies in a random y-axis positision in the gameplay portion of the screen
-        enemy_array[i].max_y_offset = 0;
-        enemy_array[i].min_y_offset = 0;
-        enemy_array[i].live = 0;
-        enemy_array[i].length = 0;
+    hud_invalidate(&g->heads_up);             // the display has been cleared so needs drawing again
+    paint_character(g->ship_x, g->ship_y, &spaceship_sprite, SET);
+    g->new_state = 1;        // move to next state once initial conditions are set
+    {
+        PROFILE_ZONE(PROFILE_REFRESH);
+        lcd.refresh();
     }
+    sched_start(g->task_ship, sched_ticks(0.1));
+    g->no_of_obj = 0;        // no enemies currently
+    entity_clear(&g->enemies);
+    broad_clear(&g->enemy_index);
 }
 
-void shipcontrol()      // function for controlling the ship using the joystick
+void shipcontrol(void *context)     // function for controlling the ship using the joystick
 {
-    paint_character(ship_x, ship_y, spaceship, CLEAR);              // erase previous position of ship
-    if (pot_y > (float)0.6 && ship_y < HEIGHT - SHIP_OFFSET - 1) {  // moving the ship down
-        ship_y++;
+    PROFILE_ZONE(PROFILE_SHIP);
+    game *g = (game *)context;
+    int x = g->ship_x, y = g->ship_y;
+
+    paint_character(g->ship_x, g->ship_y, &spaceship_sprite, CLEAR);              // erase previous position of ship
+    if (g->input.dy > 0 && g->ship_y < HEIGHT - SHIP_OFFSET - 1) {     // moving the ship down
+        g->ship_y++;
     }
-    if (pot_y < (float)0.4 && ship_y > 12) {                        // moving ship up
-        ship_y--;
+    if (g->input.dy < 0 && g->ship_y > 12) {                           // moving ship up
+        g->ship_y--;
     }
-    if (pot_x > (float)0.6 && ship_x < WIDTH - SHIP_OFFSET - 1) {   // moving ship right
-        ship_x++;
+    if (g->input.dx > 0 && g->ship_x < WIDTH - SHIP_OFFSET - 1) {      // moving ship right
+        g->ship_x++;
     }
-    if (pot_x < (float)0.4 && ship_x > SHIP_OFFSET) {               // moving ship left
-        ship_x--;
+    if (g->input.dx < 0 && g->ship_x > SHIP_OFFSET) {                  // moving ship left
+        g->ship_x--;
     }
-    paint_character(ship_x, ship_y, spaceship, SET);    // display the ship once new position is calculated
-    ticker_ship.attach(&timer_isr_ship,pot);            // potentiometer controls the ships speed, as a form of difficulty  setting
-    lcd.refresh();                                      // refresh display
+    if (g->ship_x != x || g->ship_y != y) {
+        latency_mark(g->move_trace, LATENCY_HANDLED);
+    }
+    paint_character(g->ship_x, g->ship_y, &spaceship_sprite, SET);    // display the ship once new position is calculated
+    latency_mark(g->move_trace, LATENCY_DRAWN);
+    sched_start(g->task_ship, g->input.speed);         // potentiometer controls the ships speed, as a form of difficulty  setting
 }
 
-void paint_character (int xcoord, int ycoord, image *Character, int flag)       // displays an image
+void paint_character (int xcoord, int ycoord, const Sprite *Character, int flag)    // displays an image
 {
-    int i;
-    for (i=0; i<80 && Character[i].x != 99; i++) {
-        if (flag == 1) {                                                        // if a 1 is used, the image is displayed             
-            lcd.setPixel (xcoord + Character[i].x, ycoord + Character[i].y);    
-        } else {
-            lcd.clearPixel (xcoord + Character[i].x, ycoord + Character[i].y);  // else it is cleared
-        }
+    PROFILE_ZONE(PROFILE_PAINT);
+    lcd.drawSprite(xcoord, ycoord, Character, (flag == SET) ? SPRITE_SET : SPRITE_CLEAR);  // if a 1 is used, the image is displayed, else it is cleared
+}
+
+void shoot(void *context)   // fires a bullet from the tip of the ship, any number can be in flight
+{
+    PROFILE_ZONE(PROFILE_SHOOT);
+    game *g = (game *)context;
+
+    if (g->alive == 1 && launch_bullet(g, g->ship_x + SHIP_OFFSET, g->ship_y, 1, PROJECTILE_PLAYER)) {
+        latency_mark(g->fire_trace, LATENCY_HANDLED);    // the bullet is drawn when the bullets next move
     }
 }
 
-void shoot()            // routine for shooting a bullet
+void run_timers(game *g)
 {
-    static int bullet_x = 0;
-    static int bullet_y = 0;
-    static int bullet_length = 0;
+    uint32_t expired[WHEEL_KINDS][ENTITY_WORDS];
     int i;
-    int j;
-    if (bullet_length == 0) {                   // bullet to come out of the tip of the ship
-        bullet_x = ship_x + SHIP_OFFSET;        // x-axis bullet starting location
-        bullet_y = ship_y;                      // y-axis bullet starting location
-    }
-    if (bullet_x < WIDTH) {                     // if the bullet is on screen,
-        lcd.setPixel (bullet_x,bullet_y);       // set the pixel
-    }
-    if (bullet_length == 3 || bullet_x == WIDTH) {                  // keeps the bullet to a length of 3 pixels
-        lcd.clearPixel (bullet_x - bullet_length, bullet_y);        // clears pixels behind bullet
-        if (bullet_x == WIDTH) {                                    // decrement the bullet if it is off the screen,
-            bullet_length--;                                        // so it doesn't completely disappear at once
-        }
-    } else {
-        bullet_length++;                        // if the bullet isn't at the edge of the lcd or of 3 length, increment the bullet length
-    }
-    if (bullet_x < WIDTH) {                     // if the bullet is on screen,
-        bullet_x++;                             // increment on x-axis
-        for (i = 0; i < state[g_state].total_objects; i++) {                                // used for clearing a bullet if it
-            if (bullet_y >= (enemy_array[i].y - enemy_array[i].min_y_offset) &&             // manages to touch an enemy
-                    bullet_y <= (enemy_array[i].y + enemy_array[i].max_y_offset) &&
-                    (bullet_x == enemy_array[i].x || bullet_x == enemy_array[i].x+1)&&      // x+1 is used because if the two move simultaneously the bullet could skip over an enemy
-                    enemy_array[i].live == 1) {
-                enemy_array[i].live = 0;                    // clears the enemy
-                g_no_of_obj--;                              // one less enemy
-                g_score += state[g_state].score_value;      // adds appropiate number to score relevant to enemy type
-                for (j = 0; j <= bullet_length; j++) {
-                    lcd.clearPixel (bullet_x - (bullet_length-j), bullet_y);
-                }
-                bullet_length = 0;
-                if (enemy_array[i].clear_object) {          // for boss do not clear
-                    paint_character(enemy_array[i].x, enemy_array[i].y, state[g_state].space_object, CLEAR);
-                }
-            }
-            if (bullet_y == (enemy_array[i].bullet_y) &&    // check for bullets head-on
-                    (bullet_x == enemy_array[i].bullet_x || bullet_x == enemy_array[i].bullet_x+1) &&      //X+1 is used because if the two move simultaneously the bullet could skip over an enemy
-                    enemy_array[i].bullet_live == 1) {
-                enemy_array[i].bullet_live = 0;             // clears the bullet
-
-                for (j = 0; j <= bullet_length; j++) {
-                    lcd.clearPixel (bullet_x - (bullet_length-j), bullet_y);
-                    lcd.clearPixel (enemy_array[i].bullet_x + (enemy_array[i].bullet_length - j), enemy_array[i].bullet_y);
-                }
-                bullet_length = 0;
-                enemy_array[i].bullet_length = 0;
-            }
-        }
+
+    wheel_advance(&g->timers, g->input_tick, expired);     // only the timers due this tick are visited
+    for (i = entity_find(expired[WHEEL_SPAWN], 0); i >= 0; i = entity_find(expired[WHEEL_SPAWN], i + 1)) {
+        spawn_enemy(g, i);
     }
-    if (bullet_length == 0) {       //reseting the variables
-        bullet_x = 0;
-        bullet_y = 0;
-        bullet_length = 0;
-        ticker_bullet.detach();
-        lcd.clearPixel(WIDTH, bullet_y);
-    } else {
-        ticker_bullet.attach (&timer_isr_bullet,0.02);    //bullet speed
+    for (i = entity_find(expired[WHEEL_FIRE], 0); i >= 0; i = entity_find(expired[WHEEL_FIRE], i + 1)) {
+        enemy_shoot(g, i);
     }
-    lcd.refresh();
 }
 
-void enemy_shoot() // enemies that can shoot will use this
+void spawn_enemy(game *g, int i)
 {
-    int i;
-    int j;
+    entity_reset(g->enemies.waiting, i);
+    entity_set(g->enemies.live, i);
+    enemy_moved(g, i);
+    schedule_fire(g, i);
+}
+
+// the time to an enemy's next shot is exponentially distributed, as if it had an even chance of firing every tick
+void schedule_fire(game *g, int i)
+{
+    if (state[g->state].shoot_ability == 1 && g->alive == 1 && entity_test(g->enemies.live, i)) {
+        float u = ((prng_next(&g->random, PRNG_FIRE) >> 8) + 1) * (1.0f / (1 << 24));     // 0 < u <= 1
+        int ticks = 1 + (int)(-logf(u) * (ENEMY_FIRE_MEAN / SCHED_TICK));
+        wheel_set(&g->timers, WHEEL_FIRE, i, g->input_tick + ticks);
+    }
+}
 
-    for (i = 0; i < state[g_state].total_objects; i++) {       // loops round enemies in array
-        if (enemy_array[i].bullet_live == 0 && (rand() % 400) == 1  && enemy_array[i].live == 1 && g_no_of_obj > 0) {  //to make sure bullets arent constantly firing the random number has to match
-            enemy_array[i].bullet_live = 1;                    // flag to activate a shoot process
+void enemy_shoot(game *g, int i)
+{
+    PROFILE_ZONE(PROFILE_ENEMY_SHOOT);
+    if (entity_test(g->enemies.live, i) && !entity_test(g->enemies.bullet_live, i)) {
+        if (launch_bullet(g, g->enemies.x[i], g->enemies.y[i], -1, i)) {          // one bullet at a time from each enemy
+            entity_set(g->enemies.bullet_live, i);
+        } else {
+            schedule_fire(g, i);        // too many bullets in flight, try again later
         }
-        if (enemy_array[i].bullet_live == 1 ) {                // this object is shooting
+    }
+}
 
-            if (enemy_array[i].bullet_length == 0) {           // bullet has not yet been fired
-                enemy_array[i].bullet_x = enemy_array[i].x;    // launch the bullet from gun object x
-                enemy_array[i].bullet_y = enemy_array[i].y;    // and y coordinates
-            }
-            if (enemy_array[i].bullet_x > -1) {                                     // if the enemy bullet is on screen,
-                lcd.setPixel (enemy_array[i].bullet_x, enemy_array[i].bullet_y);    // set the pixel
-            }
+int launch_bullet(game *g, int x, int y, int dx, int owner)
+{
+    if (projectile_spawn(&g->bullets, x, y, dx, owner) == NULL) {    // pool is full
+        return 0;
+    }
+    if (!sched_running(g->task_bullet)) {
+        sched_start(g->task_bullet, sched_ticks(0.02 * PROJECTILE_SPEED));   // bullet speed, a pixel every 20 ms
+    }
+    return 1;
+}
+
+void move_bullets(void *context)     // moves every bullet in flight, then works out what they hit
+{
+    game *g = (game *)context;
+    int i;
+    projectile *p;
 
-            if (enemy_array[i].bullet_length == 3 || enemy_array[i].bullet_x == -1) {   // keeps the bullet to a length of 3 pixels
-                lcd.clearPixel (enemy_array[i].bullet_x + enemy_array[i].bullet_length, enemy_array[i].bullet_y);        //clears pixels behind bullet
-                if (enemy_array[i].bullet_x == -1) {                                    // decrement the bullet if it is off the screen,
-                    enemy_array[i].bullet_length--;                                     // so it doesn't completely disappear at once
-                }
+    for (i = 0; i < g->bullets.count; i++) {
+        projectile_step(&g->bullets.live[i], &lcd);
+    }
+    latency_mark(g->fire_trace, LATENCY_DRAWN);
+    for (i = 0; i < g->bullets.count; i++) {
+        p = &g->bullets.live[i];
+        if (p->length > 0) {                    // may have been spent by an earlier hit this step
+            if (p->owner == PROJECTILE_PLAYER) {
+                player_bullet_hits(g, p);
             } else {
-                enemy_array[i].bullet_length++;        // if the enemy bullet isn't at the edge of the lcd or of 3 length, increment the enemy bullet length
+                enemy_bullet_hits(g, p);
             }
-            if (enemy_array[i].bullet_x > -1) {                     // if the enemy bullet is on screen,
-                enemy_array[i].bullet_x--;                          // decrement on x-axis to move across screen
-                if (enemy_array[i].bullet_y <= (ship_y + SHIP_OFFSET) &&                                // if a bullet manages to touch the ship
-                        enemy_array[i].bullet_y >= (ship_y - SHIP_OFFSET) &&
-                        (enemy_array[i].bullet_x == ship_x || enemy_array[i].bullet_x == ship_x-1)&&    //X-1 is used because if the two move simultaneously the bullet could skip over the ship
-                        g_alive == 1) {
-                    g_number_lives--;       // remove a life
-                    g_alive = 0;            // kills the ship
-                    g_new_state = 1;        // move to next state (beginning of game)
-                    for (j = 0; j <= enemy_array[i].bullet_length; j++) {               // clearing pixel behind bullet
-                        lcd.clearPixel (enemy_array[i].bullet_x + (enemy_array[i].bullet_length-j), enemy_array[i].bullet_y);
-                    }
-                    enemy_array[i].bullet_length = 0;                       // clear bullet if it hits the ship,
-                    paint_character(ship_x, ship_y, spaceship, CLEAR);      // and clear the ship
-                }
-            }
-            if (enemy_array[i].bullet_length == 0) {        // re-initialise
-                enemy_array[i].bullet_x = 0;
-                enemy_array[i].bullet_y = 0;
-                enemy_array[i].bullet_length = 0;
-                enemy_array[i].bullet_live = 0;
-                ticker_enemy_bullet.detach();
-                lcd.clearPixel(-1, enemy_array[i].bullet_y);
+        }
+    }
+    for (i = 0; i < g->bullets.count; ) {        // spent bullets go back to the pool
+        p = &g->bullets.live[i];
+        if (p->length == 0) {
+            if (p->owner != PROJECTILE_PLAYER) {
+                entity_reset(g->enemies.bullet_live, p->owner);  // that enemy can fire again
+                schedule_fire(g, p->owner);
             }
+            projectile_free(&g->bullets, i);                 // the last bullet is now at i
+        } else {
+            i++;
         }
     }
-    ticker_enemy_bullet.attach (&timer_isr_enemy_bullet,0.02);    // bullet speed
-    lcd.refresh();                                                // update lcd from buffer
+    if (g->bullets.count == 0) {
+        sched_stop(g->task_bullet);
+    }
 }
 
-void movement()     // behaviour of enemies' movement
+void player_bullet_hits(game *g, projectile *p)
 {
-
-    static int iteration = 0;          // used to make ships not appear all at once
     int i;
-
-    if(firsttime == 0) {               // initial conditions, runs first time loop runs 
-        firsttime = 1;
-        iteration = 0;
-        g_no_of_obj = state[g_state].total_objects;
-        for (i = 0; i < state[g_state].total_objects; i++) {
-            enemy_array[i].iteration = (rand() % 6)*5;          // the iteration has to match or be greater than the other to make the enemy be displayed
-            enemy_array[i].x = WIDTH -1;
-            enemy_array[i].y = (rand() % 37) + 10;              // spits out enemies in a random y-axis positision in the gameplay portion of the screen
-            enemy_array[i].max_y_offset = state[g_state].max_y_offset;
-            enemy_array[i].min_y_offset = state[g_state].min_y_offset;
-            enemy_array[i].live = 1;
-            enemy_array[i].length = -2;                         // at -2 the enemy is fully off the screen and ready to be cleared
-            enemy_array[i].clear_object = 1;
+    int x0;
+    int x1;
+    int q0;
+    int q1;
+    projectile *q;
+    uint32_t near[ENTITY_WORDS];
+
+    if (p->from >= WIDTH || state[g->state].space_object == 0) {     // the end of the trail is still leaving the screen,
+        return;                                                     // or the ship has died and the wave is over
+    }
+    projectile_swept(p, &x0, &x1);
+    broad_query(&g->enemy_index, x0, x1, g->enemies.live, near);                 // only enemies around the head of the bullet
+    for (i = entity_find(near, 0); i >= 0; i = entity_find(near, i + 1)) {      // used for clearing a bullet if it
+        if (collide_segment(enemy_hitbox(g), g->enemies.x[i], g->enemies.y[i], x0, x1, p->y)) {    // manages to touch an enemy
+            entity_reset(g->enemies.live, i);            // clears the enemy
+            broad_remove(&g->enemy_index, i);
+            wheel_cancel(&g->timers, WHEEL_FIRE, i);
+            g->no_of_obj--;                              // one less enemy
+            g->score += state[g->state].score_value;      // adds appropiate number to score relevant to enemy type
+            projectile_erase(p, &lcd);
+            if (g->enemies.clear_object[i]) {            // for boss do not clear
+                paint_character(g->enemies.x[i], g->enemies.y[i], state[g->state].space_object, CLEAR);
+            }
+            return;
+        }
+    }
+    for (i = 0; i < g->bullets.count; i++) {             // check for bullets head-on
+        q = &g->bullets.live[i];
+        if (q->owner == PROJECTILE_PLAYER || q->length == 0 || q->y != p->y) {
+            continue;
         }
-        if (state[g_state].shoot_ability == 1) {                // attach timer for shooting enemies
-            ticker_enemy_bullet.attach (&timer_isr_enemy_bullet,0.02);
+        projectile_swept(q, &q0, &q1);
+        if (collide_head_on(x0, x1, q1, q0)) {     // both have moved this step, so they could have just passed each other
+            projectile_erase(p, &lcd);
+            projectile_erase(q, &lcd);
+            return;
         }
     }
-    iteration++;    // loop counter
-    for (i = 0; i < state[g_state].total_objects; i++) {
-        if (iteration >= enemy_array[i].iteration && enemy_array[i].live == 1) {
-            paint_character(enemy_array[i].x, enemy_array[i].y, state[g_state].space_object, CLEAR);     // clear opponent
-            enemy_array[i].x--;                                                                          // move enemy along screen
-            if (enemy_array[i].x < enemy_array[i].length) {                       // opponent off the screen
-                enemy_array[i].live = 0;
-                g_no_of_obj--;
-            } else {
-                paint_character (enemy_array[i].x, enemy_array[i].y, state[g_state].space_object, SET);
-                if (((ship_y + SHIP_OFFSET >= (enemy_array[i].y - enemy_array[i].min_y_offset)) ||        // setting up which pixel dimensions that will cause a collision
-                        (ship_y - SHIP_OFFSET >= (enemy_array[i].y - enemy_array[i].min_y_offset))) &&    // and kill the shapeship
-                        ((ship_y - SHIP_OFFSET <= (enemy_array[i].y + enemy_array[i].max_y_offset)) ||
-                         (ship_y + SHIP_OFFSET <= (enemy_array[i].y + enemy_array[i].max_y_offset))) &&
-                        (ship_x == enemy_array[i].x)) {
-                    paint_character(ship_x, ship_y, spaceship, CLEAR);            // enemy collision kills spaceship, blanks it out
-                    g_number_lives--;                                             // remove a life
-                    g_alive = 0;                                                  // ship dead
-                    g_new_state = 1;                                              // go to next state
-                } else {
-                    paint_character (enemy_array[i].x, enemy_array[i].y, state[g_state].space_object, SET);     
-                }
+}
+
+void enemy_bullet_hits(game *g, projectile *p)
+{
+    int x0;
+    int x1;
+
+    projectile_swept(p, &x0, &x1);
+    if (p->from > -1 &&                                                 // if a bullet manages to touch the ship, anywhere its head has been
+            collide_segment(&spaceship_sprite, g->ship_x, g->ship_y, x0, x1, p->y) &&     // since it last moved
+            g->alive == 1) {
+        g->number_lives--;       // remove a life
+        g->alive = 0;            // kills the ship
+        g->new_state = 1;        // move to next state (beginning of game)
+        projectile_erase(p, &lcd);                                      // clear bullet if it hits the ship,
+        paint_character(g->ship_x, g->ship_y, &spaceship_sprite, CLEAR);      // and clear the ship
+    }
+}
+
+void movement(game *g)      // behaviour of enemies' movement
+{
+    PROFILE_ZONE(PROFILE_MOVEMENT);
+    int i;
+    int step;
+    uint32_t near[ENTITY_WORDS];
+
+    if(g->firsttime == 0) {               // initial conditions, runs first time loop runs 
+        g->firsttime = 1;
+        g->no_of_obj = state[g->state].total_objects;
+        entity_clear(&g->enemies);
+        broad_clear(&g->enemy_index);
+        for (i = 0; i < state[g->state].total_objects; i++) {
+            step = prng_below(&g->random, PRNG_SPAWN, 6)*5;     // the step of the wave on which the enemy appears, so they don't appear all at once
+            g->enemies.x[i] = WIDTH -1;
+            g->enemies.y[i] = prng_between(&g->random, PRNG_SPAWN, 11, 46);              // spits out enemies in a random y-axis positision in the gameplay portion of the screen, below the boundary
+            entity_set(g->enemies.waiting, i);                   // appears when its spawn timer is due
+            g->enemies.length[i] = -sprite_right(*state[g->state].space_object);   // past here the enemy is fully off the screen and ready to be cleared
+            g->enemies.clear_object[i] = 1;
+            if (step == 0) {
+                spawn_enemy(g, i);
+            } else {        // this is the first step, step n comes n - 1 FSM periods later
+                wheel_set(&g->timers, WHEEL_SPAWN, i, g->input_tick + (step - 1)*sched_ticks(state[g->state].time));
             }
         }
     }
-    if (g_no_of_obj == 0 || g_alive == 0) {         // if there are no enemies or the ship dies
-        g_new_state = 1;                            // next state
-        firsttime = 0;                              // re-initialise
-        iteration = 0;
-        if (state[g_state].shoot_ability == 1) {    // detach ticker
-            ticker_enemy_bullet.detach();
+    for (i = entity_find(g->enemies.live, 0); i >= 0; i = entity_find(g->enemies.live, i + 1)) {
+        paint_character(g->enemies.x[i], g->enemies.y[i], state[g->state].space_object, CLEAR);     // clear opponent
+        g->enemies.x[i]--;                                                                          // move enemy along screen
+        if (g->enemies.x[i] < g->enemies.length[i]) {                       // opponent off the screen
+            entity_reset(g->enemies.live, i);
+            broad_remove(&g->enemy_index, i);
+            wheel_cancel(&g->timers, WHEEL_FIRE, i);
+            g->no_of_obj--;
+        } else {
+            paint_character (g->enemies.x[i], g->enemies.y[i], state[g->state].space_object, SET);
+            enemy_moved(g, i);
+        }
+    }
+    broad_query(&g->enemy_index, g->ship_x - sprite_left(spaceship_sprite), g->ship_x + sprite_right(spaceship_sprite),
+                g->enemies.live, near);      // only enemies in the ship's columns can hit it
+    for (i = entity_find(near, 0); i >= 0 && g->alive == 1; i = entity_find(near, i + 1)) {
+        if (collide_sprites(&spaceship_sprite, g->ship_x, g->ship_y, state[g->state].space_object, g->enemies.x[i], g->enemies.y[i])) {   // the pixels of the two touch
+            paint_character(g->ship_x, g->ship_y, &spaceship_sprite, CLEAR);            // enemy collision kills spaceship, blanks it out
+            g->number_lives--;                                             // remove a life
+            g->alive = 0;                                                  // ship dead
+            g->new_state = 1;                                              // go to next state
         }
     }
+    if (g->no_of_obj == 0 || g->alive == 0) {         // if there are no enemies or the ship dies
+        g->new_state = 1;                            // next state
+        g->firsttime = 0;                              // re-initialise
+    }
+}
+
+const Sprite *enemy_hitbox(const game *g)
+{
+    if (state[g->state].shoot_offset) {      // the boss is hit at its guns and its core, each a single point
+        return &point_sprite;
+    }
+    return state[g->state].space_object;
 }
 
-void boss_movement()    // behaviour of the boss
+void enemy_moved(game *g, int i)    // keeps the collision index up to date with an enemy's sprite
 {
+    const Sprite *sprite = state[g->state].space_object;
+    broad_move(&g->enemy_index, i, g->enemies.x[i] - sprite_left(*sprite), g->enemies.x[i] + sprite_right(*sprite));
+}
 
-    static int l_direction = 0;         // initialise local variables
-    static int l_boss;
-    static int l_boss_alive;
+void boss_movement(game *g)     // behaviour of the boss
+{
+    PROFILE_ZONE(PROFILE_BOSS);
+    int l_boss = BOSS_CORE;     // initialise local variables
+    int l_boss_alive;
     int i;
 
-    l_boss = state[g_state].min_y_offset;
-
-    if(firsttime == 0) {                        // initialisation
-        firsttime = 1;
-        for (i = 0; i < state[g_state].total_objects; i++) {    // 9 total objects for the boss, so he can shoot from 9 places and has 9 lives
-            enemy_array[i].live = 1;                            // shooting a gun on the boss will remove 1 life and 1 gun from the boss
-            enemy_array[i].max_y_offset = 0;                    // each row is being treated as a seperate entity
-            enemy_array[i].min_y_offset = 0;
-            enemy_array[i].clear_object = 0;
+    if(g->firsttime == 0) {                        // initialisation
+        g->firsttime = 1;
+        entity_clear(&g->enemies);
+        broad_clear(&g->enemy_index);
+        for (i = 0; i < state[g->state].total_objects; i++) {    // 9 total objects for the boss, so he can shoot from 9 places and has 9 lives
+            entity_set(g->enemies.live, i);                      // shooting a gun on the boss will remove 1 life and 1 gun from the boss
+            g->enemies.clear_object[i] = 0;
 
         }
-        enemy_array[l_boss].x = WIDTH -1;              // initial x coordinate
-        enemy_array[l_boss].y = HEIGHT/2;              // initial y coordinate
-        g_no_of_obj = state[g_state].total_objects;    // initial lives of boss
+        g->enemies.x[l_boss] = WIDTH -1;              // initial x coordinate
+        g->enemies.y[l_boss] = HEIGHT/2;              // initial y coordinate
+        g->no_of_obj = state[g->state].total_objects;    // initial lives of boss
 
-        if (state[g_state].shoot_ability > 0) {
-            ticker_enemy_bullet.attach (&timer_isr_enemy_bullet,0.02);  // initialise bullet speed
+        for (i = 0; i < state[g->state].total_objects; i++) {    // each gun fires on a timer of its own
+            schedule_fire(g, i);
         }
     }
 
-    for (i = 0; i < state[g_state].total_objects; i++) { // check if any of the boss's lives are left
-        l_boss_alive = 0;
-        if (enemy_array[i].live == 1) {
-            l_boss_alive = 1;
-        }
-    }
+    l_boss_alive = !entity_empty(g->enemies.live);    // check if any of the boss's lives are left
 
     if (l_boss_alive == 1) {        // movement, collisions and where boss shoots from when it's alive
-        paint_character(enemy_array[l_boss].x, enemy_array[l_boss].y, state[g_state].space_object, CLEAR);     // clear opponent
+        paint_character(g->enemies.x[l_boss], g->enemies.y[l_boss], state[g->state].space_object, CLEAR);     // clear opponent
 
-        if (l_direction == 0 && enemy_array[l_boss].x > 68) {   // movement of the boss and boundaries
-            enemy_array[l_boss].x--;                            // left
-            if (enemy_array[l_boss].x <= 68) {                  // dont move across screen like other enemies
-                l_direction = 1;
+        if (g->boss_direction == 0 && g->enemies.x[l_boss] > 68) {   // movement of the boss and boundaries
+            g->enemies.x[l_boss]--;                            // left
+            if (g->enemies.x[l_boss] <= 68) {                  // dont move across screen like other enemies
+                g->boss_direction = 1;
             }
         }
-        if (l_direction == 1) {
-            enemy_array[l_boss].y++;                // down
+        if (g->boss_direction == 1) {
+            g->enemies.y[l_boss]++;                // down
 
-            if (enemy_array[l_boss].y >= 33) {      // past 33 boss will be in death 'animation'
-                l_direction = 2;                    
+            if (g->enemies.y[l_boss] >= 33) {      // past 33 boss will be in death 'animation'
+                g->boss_direction = 2;                    
             }
         } else {
-            enemy_array[l_boss].y--;                // up
+            g->enemies.y[l_boss]--;                // up
 
-            if (enemy_array[l_boss].y <= 13) {      // go back down when boss has reached the top of the screen
-                l_direction = 1;
+            if (g->enemies.y[l_boss] <= 13) {      // go back down when boss has reached the top of the screen
+                g->boss_direction = 1;
             }
         }
 
-        if (((ship_y + SHIP_OFFSET >= (enemy_array[l_boss].y - state[g_state].max_y_offset)) ||          // setting up which pixel dimensions that will cause a collision
-                (ship_y - SHIP_OFFSET >= (enemy_array[l_boss].y - state[g_state].max_y_offset))) &&      // and kill the shapeship
-                ((ship_y - SHIP_OFFSET <= (enemy_array[l_boss].y + state[g_state].max_y_offset)) ||
-                 (ship_y + SHIP_OFFSET <= (enemy_array[l_boss].y + state[g_state].max_y_offset))) &&
-                (ship_x == enemy_array[l_boss].x)) {
-            paint_character(ship_x, ship_y, spaceship, CLEAR);          // enemy collision kills spaceship, blanks it out
-            g_number_lives--;                                           // remove a life
-            g_alive = 0;                                                // ship dead
-            g_new_state = 1;                                            // next state
+        if (g->alive == 1 &&
+                collide_sprites(&spaceship_sprite, g->ship_x, g->ship_y, state[g->state].space_object, g->enemies.x[l_boss], g->enemies.y[l_boss])) {   // the ship touches the boss
+            paint_character(g->ship_x, g->ship_y, &spaceship_sprite, CLEAR);          // enemy collision kills spaceship, blanks it out
+            g->number_lives--;                                           // remove a life
+            g->alive = 0;                                                // ship dead
+            g->new_state = 1;                                            // next state
         } else {
-            paint_character (enemy_array[l_boss].x, enemy_array[l_boss].y, state[g_state].space_object, SET);   // if it's not dead, display
+            paint_character (g->enemies.x[l_boss], g->enemies.y[l_boss], state[g->state].space_object, SET);   // if it's not dead, display
         }
 
-        for (i = 1; i < state[g_state].total_objects; i++) {            // location of shooters on boss
+        for (i = 0; i < state[g->state].total_objects; i++) {            // location of shooters on boss
             if (i != l_boss) {                                          
-                enemy_array[i].x = enemy_array[l_boss].x + state[g_state].shoot_offset[i].x;
-                enemy_array[i].y = enemy_array[l_boss].y + state[g_state].shoot_offset[i].y;
+                g->enemies.x[i] = g->enemies.x[l_boss] + state[g->state].shoot_offset[i].x;
+                g->enemies.y[i] = g->enemies.y[l_boss] + state[g->state].shoot_offset[i].y;
+            }
+            if (entity_test(g->enemies.live, i)) {
+                broad_move(&g->enemy_index, i, g->enemies.x[i], g->enemies.x[i]);    // each part of the boss is hit as a single point
             }
         }
     }
 
-    if (g_alive == 0) {   // if the ship dies
-        g_new_state = 1;  // move to the start state
-        firsttime = 0;    // re-initialise
-        if (state[g_state].shoot_ability == 1) {    // detach ticker for enemy bullets
-            ticker_enemy_bullet.detach();
-        }
+    if (g->alive == 0) {   // if the ship dies
+        g->new_state = 1;  // move to the start state
+        g->firsttime = 0;    // re-initialise
 
     }
 
     if (l_boss_alive <= 0) {   // if the boss dies
 
-        paint_character(enemy_array[l_boss].x, enemy_array[l_boss].y, state[g_state].space_object, CLEAR);      // clear the boss
-        if (enemy_array[l_boss].y == HEIGHT + 4) {                                                              // if the boss is off the screen,
-            g_new_state = 1;                                                                                    // then move to the start state
-            firsttime = 0;                                                                                      // re-intialise
-            if (state[g_state].shoot_ability == 1) {    // detach ticker for enemy bullets
-                ticker_enemy_bullet.detach();
-            }
+        paint_character(g->enemies.x[l_boss], g->enemies.y[l_boss], state[g->state].space_object, CLEAR);      // clear the boss
+        if (g->enemies.y[l_boss] == HEIGHT + 4) {                                                              // if the boss is off the screen,
+            g->new_state = 1;                                                                                    // then move to the start state
+            g->firsttime = 0;                                                                                      // re-intialise
         } else {
-            g_no_of_obj = 0;
-            enemy_array[l_boss].y++;                    // lower it off the screen before clearing (death 'animation')
-            paint_character(enemy_array[l_boss].x, enemy_array[l_boss].y, state[g_state].space_object, SET);   // repaint the boss as it moves down
+            g->no_of_obj = 0;
+            g->enemies.y[l_boss]++;                    // lower it off the screen before clearing (death 'animation')
+            paint_character(g->enemies.x[l_boss], g->enemies.y[l_boss], state[g->state].space_object, SET);   // repaint the boss as it moves down
         }
     }
 }
 
-void endscreen()
+void endscreen(game *g)
 {
     lcd.clear();
     lcd.printString("GAME OVER",15,2);                          // display game over screen
-    int length = sprintf(buffer_score,"Score: %3d",g_score);    // print formatted data to buffer
+    int length = sprintf(g->buffer_score,"Score: %3d",g->score);    // print formatted data to buffer
     if (length <= 11) {                                         // if string fits on display
-        lcd.printString(buffer_score,15,3);                     // display on screen
+        lcd.printString(g->buffer_score,15,3);                     // display on screen
     }
+    PROFILE_ZONE(PROFILE_REFRESH);
     lcd.refresh();                                              // update display
 }
-
-void timer_isr_ship()
-{
-    g_timer_flag_ship = 1;             // set flag in ISR
-}
-
-void switch_external_isr()
-{
-    g_switch_external_flag = 1;        // set flag in ISR
-}
-
-void timer_isr_bullet()
-{
-    g_timer_flag_bullet = 1;           // set flag in ISR
-}
-
-void timer_isr_enemy_bullet()
-{
-    g_timer_flag_enemy_bullet = 1;     // set flag in ISR
-}
-
-void timer_isr_fsm()
-{
-    g_timer_flag_fsm = 1;              // set flag in ISR
-}
\ No newline at end of file
@@ -10,15 +10,18 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-#define MAX_ENEMIES 20
 #define SHIP_OFFSET 3
 #define START_STATE 0
 #define ASTRO1_STATE 1
 #define ALIEN1_STATE 2
 #define BOSS1_STATE 3
 #define DEATH_STATE 4
+#define BOSS_CORE 4     // the boss's entry in enemy_array, its other entries are its guns
 #define CLEAR 0
 #define SET 1
+#define SUSPEND_HOLD 2.0    // seconds the button is held down to suspend the game to flash
+#define ENEMY_FIRE_MEAN 8.0     // seconds an enemy waits on average before firing, once it can
+#define RECORD_INPUT 0      // 1 records each game's inputs to the serial port, 2 to input.rec on the local file system
 
 
 /**
@@ -35,187 +38,145 @@
 @namespace lcd
 @brief output for the Nokia display, with the pins being: VCC, SCE, RST, D/C, MOSI, SCLK, LED, in respective order.
 */
-AnalogIn pot_x(PTB2);
-AnalogIn pot_y(PTB3);
-AnalogIn pot(PTB10);
-InterruptIn switch_external(PTB18);
-DigitalOut led(PTC2);   
-N5110 lcd (PTE26 , PTA0 , PTC4 , PTD0 , PTD2 , PTD1 , PTC3);
-
-Ticker ticker_ship;          /*!< Ticker used for ship movement */
-Ticker ticker_bullet;        /*!< Ticker used for bullet speed */
-Ticker ticker_enemy_bullet;  /*!< Ticker used for enemy bullet speed */
-Ticker ticker_fsm;           /*!< Ticker used for timings in FSM */
+GAME_LOCAL AnalogIn pot_x(PTB2);
+GAME_LOCAL AnalogIn pot_y(PTB3);
+GAME_LOCAL AnalogIn pot(PTB10);
+GAME_LOCAL InterruptIn switch_external(PTB18);
+GAME_LOCAL DigitalOut led(PTC2);   
+GAME_LOCAL N5110 lcd (PTE26 , PTA0 , PTC4 , PTD0 , PTD2 , PTD1 , PTC3);
 
-/**
-Structure for creating an image.
-@brief To create an image there must an x-y coordinate pair for each pixel, from a chosen point.
-@param x - x-coordinate from reference
-@param y - y-coordinate from reference
-*/
-struct imagestruct {
-    int x;
-    int y;
-};
-typedef imagestruct image;
-
-int total_objects; /*!< Number of enemies */
-
-volatile int g_switch_external_flag = 0;    /*!< External switch flag set in ISR */
-volatile int g_timer_flag_ship = 0;         /*!< Timer flag for ship speed set in ISR */
-volatile int g_timer_flag_bullet = 0;       /*!< Timer flag for ship bullet speed set in ISR */
-volatile int g_timer_flag_enemy_bullet = 0; /*!< Timer flag for enemy bullet speed set in ISR */
-volatile int g_timer_flag_fsm = 0;          /*!< Timer flag for the FSM set in ISR */
-int length_score;       /*!< Buffer size for score */
-int length_lives;       /*!< Buffer size for lives */
-int g_score = 0;        /*!< Score for the game, increases when enemies are killed by the player */
-int g_alive = 0;        /*!< Alive or dead state of the spaceship, 1 or 0 */
-int g_number_lives = 0; /*!< Number of lives the ship has */
-int g_no_of_obj = 0;    /*!< Number of enemies */
-int g_new_state = 0;    /*!< Decides whether the next state should be accessed, 1 or 0 */
-int ship_x;             /*!< The x-coordinate of the ship */
-int ship_y;             /*!< The y-coordinate of the ship */
-int x;                  /*!< Used for x-coordinates */
-int y;                  /*!< Used for y-coordinates */
-int asteroid_x;         /*!< The x-coordinates of the asteroids */
-int firsttime;          /*!< Used during initialisation of certain routines, 1 or 0 */
-char buffer_score[14];  /*!< Score buffer used to display the score in a printable string */
-char buffer_lives[7];   /*!< Lives buffer used to display lives in a printable string */
+GAME_LOCAL game g_game;    /*!< The game, see game.h */
 
 /**
 Finite State Machine used for moving to next level or back to start when dead etc.
-@param max_y_offset - The size of enemies, need to know for collisions. Amount of pixels that are part of the enemy, above it.
-@param min_y_offset - The size of enemies, need to know for collisions. Amount of pixels that are part of the enemy, below it.
 @param time - Speed of movement of enemies in each state
 @param total_objects - Amount of enemies that wave
 @param score_value - The amount of points an enemy adds to your score
 @param shoot_ability - If the enemy can shoot or not
 @param shoot_offset - Where the enemy shoud should from. Default is the centre point of the enemy
 @param function - Defines the behaviour of the enemies
-@param space_object - What the displayed enemy(s) will look like
+@param space_object - What the displayed enemy(s) will look like, packed for drawing
 @param nextState[] - Defines which state will happen next
 */
 struct FSM {
-    int max_y_offset;
-    int min_y_offset;
     float time;
     int total_objects;
     int score_value;
     int shoot_ability;
-    image *shoot_offset;
-    void (*function)();
-    image *space_object;
+    const image *shoot_offset;
+    void (*function)(game *g);
+    const Sprite *space_object;
     int nextState[3];     // array of next states
 };
 typedef FSM stateType;
 
-int g_state;    /*!< The current state */
-
-/**
-Structure for enemy data
-@param x - integer x-coordinate value
-@param y - integer y-coordinate value
-@param max_y_offset - The vertical upward pixel range of the enemy
-@param min_y_offset - The vertical downward pixel range of the enemy
-@param length - Where the enemy is fully off the screen
-@param iteration - Used for counting
-@param live - Whether the enemy is alive or not
-@param bullet_x - The enemy bullet x-coordinate
-@param bullet_y - The enemy bullet y-coordinate
-@param bullet_live - Whether an enemy bullet is active or not
-@param bullet_length - The length of an enemy bullet
-@param clear_object - Used for clearing or not clearing an enemy
-*/
-struct objects {
-    int x;
-    int y;
-    int max_y_offset;
-    int min_y_offset;
-    int length;
-    int iteration;
-    int live;
-    int bullet_x;
-    int bullet_y;
-    int bullet_live;
-    int bullet_length;
-    int clear_object;
-};
-typedef objects obj;
-obj enemy_array[MAX_ENEMIES]; /*!< The maximum amount of enemies */
-
 /**
-@namespace switch_external_isr
-@brief sets flag for switch on PCB in iterrupt service routine
+@namespace drain_events
+@brief takes the events queued by interrupts, in the order they happened, at the start of each pass of the main loop
 @namespace start
 @brief initialise values for the game in the start state
 @namespace endscreen
 @brief displays the screen when the spaceship is destroyed
-@namespace timer_isr_ship
-@brief used for timing of the ship's movement
-@namespace timer_isr_bullet
-@brief timing for the speed of a bullet
-@namespace timer_isr_fsm
-@brief used for the timings of each state
+@namespace read_inputs
+@brief reads the joystick, potentiometer and button once each tick, or takes them from the replay
+@namespace suspend
+@brief saves the game to flash, through a buffer the caller lends it, and powers down until reset, when it is resumed
+@namespace fsm_step
+@brief runs the function for the current state and sets the time until the next step
 @namespace shipcontrol
 @brief used to control the movement of the ship.
 @namespace shoot
 @brief for firing a bullet
+@namespace run_timers
+@brief brings on the enemies and fires their bullets as their timers fall due, once each tick
+@namespace spawn_enemy
+@brief brings an enemy on screen
+@namespace schedule_fire
+@brief sets when an enemy that can shoot next fires
 @namespace enemy_shoot
 @brief used for enemy ships to fire bullets
+@namespace move_bullets
+@brief moves every bullet in flight and removes the ones that are spent
 @namespace movement
 @brief this is for the movement of the enemies
 @namespace boss_movement
 @brief the movement behaviour of the boss
 */
 
-void switch_external_isr();
-void start();
-void endscreen();
-void timer_isr_ship();
-void timer_isr_bullet();
-void timer_isr_enemy_bullet();
-void timer_isr_fsm();
-void shipcontrol();
-void shoot();
-void enemy_shoot();
-void movement();
-void boss_movement();
+void start(game *g);
+void endscreen(game *g);
+void drain_events(game *g);
+void read_inputs(game *g);
+void suspend(game *g, unsigned char *blob, int size);
+void fsm_step(void *context);
+void shipcontrol(void *context);
+void shoot(void *context);
+void run_timers(game *g);
+void spawn_enemy(game *g, int i);
+void schedule_fire(game *g, int i);
+void enemy_shoot(game *g, int i);
+void move_bullets(void *context);
+void movement(game *g);
+void boss_movement(game *g);
 
 /**
 Displays an image on the display
 @param xcoord - x-coordinate of image (integer)
 @param ycoord - y-coordinate of image (integer)
-@param image - calls an image 
+@param sprite - the image, packed into columns
 @param flag - display or clear the image
 @returns an array of pixels displayed on the lcd
 */
-void paint_character(int, int, image *, int);
-
-image spaceship[] = {0,0,-3,-3,-2,-2,-1,-2,-2,-1,-1,-1,-1,0,-1,1,-1,2,-2,1,
-                        -2,2,-1,2,-3,3,0,-1,0,1,1,0,1,-1,1,1,2,0,3,0,99};         /*!< The image of the spaceship */
-image asteroid[] = {0,0,-1,-1,0,-1,0,-2,1,-1,1,0,2,0,-1,1,0,1,0,1,1,1,1,2,99};    /*!< The image of the asteroids */
-image enemy_spaceship[] = {0,0,0,1,0,-1,1,-2,1,2,-1,0,99};                        /*!< The image of the enemy spaceships */
-image boss1[] = {2,-4, 3,-4, 4,-4,
-                 -1,-3, 0,-3, 1,-3, 2,-3, 3,-3,
-                 -3,-2, -2,-2, -1,-2, 0,-2, 1,-2, 2,-2, 3,-2, 4,-2, 5,-2,
-                 -5,-1, -4,-1, -3,-1, -2,-1, -1,-1, 0,-1, 1,-1, 2,-1, 3,-1,
-                 -6,0, -5,0, -4,0, -3,0, -2,0, -1,0, 0,0, 1,0, 2,0, 3,0, 4,0,
-                 -5,1, -4,1, -3,1, -2,1, -1,1, 0,1, 1,1, 2,1, 3,1,
-                 -3,2, -2,2, -1,2, 0,2, 1,2, 2,2, 3,2, 4,2, 5,2,
-                 -1,3, 0,3, 1,3, 2,3, 3,3,
-                 2,4, 3,4, 4,4, 99};                                              /*!< The image of the boss */
-image boss_guns[] = {2,-4, -1,-3, -4,-2, -5,-1, -6,0, -5,1, -4,2, -1,3, 2,4, 99}; /*!< Used to make bullets fire from the correct positions on the boss */
+void paint_character(int, int, const Sprite *, int);
+
+/**
+Fires a bullet and starts the bullet task if none were in flight
+@param g - the game
+@param x - x-coordinate to fire from
+@param y - y-coordinate to fire from
+@param dx - direction of travel, 1 for right and -1 for left
+@param owner - PROJECTILE_PLAYER or the number of the enemy firing
+@returns 1 if the bullet was fired, 0 if there were already too many in flight
+*/
+int launch_bullet(game *g, int x, int y, int dx, int owner);
+
+/**
+Checks whether a bullet fired by the player has hit an enemy or met an enemy bullet head-on, and clears both if so
+@param g - the game
+@param p - the bullet
+*/
+void player_bullet_hits(game *g, projectile *p);
+
+/**
+Checks whether an enemy bullet has hit the ship, and kills the ship if so
+@param g - the game
+@param p - the bullet
+*/
+void enemy_bullet_hits(game *g, projectile *p);
+
+/**
+@param g - the game
+@returns the sprite a bullet has to touch to hit an enemy in the current state
+*/
+const Sprite *enemy_hitbox(const game *g);
+
+/**
+Updates the columns an enemy covers in the collision index after it has moved
+@param g - the game
+@param i - the enemy
+*/
+void enemy_moved(game *g, int i);
 
 /**
 FSM
 @brief Sets the changes for each state.
 */
 stateType state[5] = {
-    {0, 0, 3.0,  0,  0, 0, 0, start, 0, {START_STATE, ASTRO1_STATE, DEATH_STATE}},
-    {2, 2, 0.2, 10,  5, 0, 0, movement, asteroid, {START_STATE, ALIEN1_STATE, DEATH_STATE}},
-    {2, 2, 0.2, 15, 10, 1, 0, movement, enemy_spaceship, {START_STATE, BOSS1_STATE, DEATH_STATE}},
-    {4, 4, 0.3, 9, 100, 1, boss_guns, boss_movement, boss1, {START_STATE, ASTRO1_STATE, DEATH_STATE}},
-    {0, 0, 0.0, 0,   0, 0, 0, 0, 0, {0, 0, 0}}
+    {3.0,  0,  0, 0, 0, start, 0, {START_STATE, ASTRO1_STATE, DEATH_STATE}},
+    {0.2, 10,  5, 0, 0, movement, &asteroid_sprite, {START_STATE, ALIEN1_STATE, DEATH_STATE}},
+    {0.2, 15, 10, 1, 0, movement, &enemy_spaceship_sprite, {START_STATE, BOSS1_STATE, DEATH_STATE}},
+    {0.3, 9, 100, 1, boss_guns, boss_movement, &boss1_sprite, {START_STATE, ASTRO1_STATE, DEATH_STATE}},
+    {0.0, 0,   0, 0, 0, 0, 0, {0, 0, 0}}
 }; 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+@file prng.cpp
+
+@brief Random number generator implementation
+
+*/
+
+#include "mbed.h"
+#include "prng.h"
+
+// murmur3's finaliser, every bit of the seed affects every bit of the result
+static uint32_t mix(uint32_t z)
+{
+    z = (z ^ (z >> 16)) * 0x85EBCA6BU;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35U;
+    return z ^ (z >> 16);
+}
+
+void prng_seed(prng *p, uint32_t seed)
+{
+    for (int i = 0; i < PRNG_STREAMS; i++) {
+        uint32_t state = mix(seed + 0x9E3779B9U * (i + 1));
+        p->state[i] = state ? state : 1;     // xorshift never leaves zero
+    }
+}
+
+#if defined(TARGET_K64F)
+
+uint32_t prng_entropy()
+{
+    SIM->SCGC6 |= SIM_SCGC6_RNGA_MASK;      // clock the RNGA
+    RNG->CR |= RNG_CR_GO_MASK;
+    while (!(RNG->SR & RNG_SR_OREG_LVL_MASK)) {
+    }
+    uint32_t seed = RNG->OR;
+    RNG->CR &= ~RNG_CR_GO_MASK;             // it draws power while running
+    return seed;
+}
+
+#else
+
+uint32_t prng_entropy()
+{
+    return rand();      // seeded by the host for each game
+}
+
+#endif
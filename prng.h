@@ -0,0 +1,89 @@
+/**
+@file prng.h
+@brief Small, fast random number generator for SPACEGAME, with a separate stream for each use.
+@brief Each stream is an xorshift32 generator whose output is scrambled with a multiply, so a number costs a few
+@brief cycles and no library call. Every stream is derived from one seed but steps on its own, so a change to how
+@brief often one part of the game draws numbers doesn't change what any other part gets. Numbers in a range are
+@brief made with Lemire's multiply-and-shift, which has no modulo bias and only divides in the rare case of a
+@brief number being rejected.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+
+#define PRNG_SPAWN 0        /*!< Stream for where and when enemies appear */
+#define PRNG_FIRE 1         /*!< Stream for when enemies fire */
+#define PRNG_EFFECTS 2      /*!< Stream for anything that is only seen, so adding an effect doesn't change the play */
+#define PRNG_STREAMS 3      /*!< Number of streams */
+
+/**
+The state of every stream
+@param state - the xorshift32 state of each stream, never zero
+*/
+struct prng {
+    uint32_t state[PRNG_STREAMS];
+};
+
+/**
+Sets every stream from one seed, mixed so that nearby seeds give unrelated streams
+@param p - the streams
+@param seed - any value
+*/
+void prng_seed(prng *p, uint32_t seed);
+
+/**
+@returns a seed from the K64F's hardware random number generator, or from rand() where there isn't one
+*/
+uint32_t prng_entropy();
+
+/**
+@param p - the streams
+@param stream - PRNG_SPAWN, PRNG_FIRE or PRNG_EFFECTS
+@returns the next 32-bit number from the stream
+*/
+inline uint32_t prng_next(prng *p, int stream)
+{
+    uint32_t x = p->state[stream];
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    p->state[stream] = x;
+    return x * 0x9E3779BBU;     // spreads the low bits into the high bits used by prng_below()
+}
+
+/**
+@param p - the streams
+@param stream - PRNG_SPAWN, PRNG_FIRE or PRNG_EFFECTS
+@param range - number of possible results, at least 1
+@returns a number from 0 to range - 1, each equally likely
+*/
+inline uint32_t prng_below(prng *p, int stream, uint32_t range)
+{
+    uint64_t m = (uint64_t)prng_next(p, stream) * range;
+    if ((uint32_t)m < range) {
+        uint32_t threshold = -range % range;    // the numbers below this would make the low results more likely
+        while ((uint32_t)m < threshold) {
+            m = (uint64_t)prng_next(p, stream) * range;
+        }
+    }
+    return m >> 32;
+}
+
+/**
+@param p - the streams
+@param stream - PRNG_SPAWN, PRNG_FIRE or PRNG_EFFECTS
+@param low - smallest result
+@param high - largest result
+@returns a number from low to high inclusive, each equally likely
+*/
+inline int prng_between(prng *p, int stream, int low, int high)
+{
+    return low + (int)prng_below(p, stream, high - low + 1);
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+@file profile.cpp
+
+@brief Cycle counting profiler implementation
+
+*/
+
+#include "mbed.h"
+#include "profile.h"
+
+#if PROFILE
+
+GAME_LOCAL profile_ring g_profile;
+
+static const char *const zone_names[PROFILE_ZONES] = {
+    "shipcontrol", "shoot", "enemy_shoot", "movement", "boss_movement", "paint_character", "hud", "refresh"
+};
+
+static void clear_frame(int frame)
+{
+    for (int i = 0; i < PROFILE_ZONES; i++) {
+        profile_zone *z = &g_profile.frames[frame][i];
+        z->calls = 0;
+        z->shortest = UINT32_MAX;
+        z->total = 0;
+        z->longest = 0;
+    }
+}
+
+void profile_init()
+{
+#if defined(TARGET_K64F)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // the DWT is off until trace is enabled
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    for (int i = 0; i < PROFILE_FRAMES; i++) {
+        clear_frame(i);
+    }
+    g_profile.current = 0;
+    g_profile.ticks = 0;
+}
+
+void profile_tick()
+{
+    g_profile.current = (g_profile.current + 1) % PROFILE_FRAMES;
+    g_profile.ticks++;
+    clear_frame(g_profile.current);
+}
+
+void profile_dump()
+{
+    const profile_ring *p = &g_profile;
+    int frames = p->ticks < PROFILE_FRAMES ? (int)p->ticks + 1 : PROFILE_FRAMES;
+
+#if defined(TARGET_K64F)
+    printf("profile: last %d ticks, in cycles of the %u MHz core\r\n", frames, (unsigned int)(SystemCoreClock / 1000000));
+#else
+    printf("profile: last %d ticks, in counts of the host's clock\r\n", frames);
+#endif
+    printf("zone              calls   shortest       mean    longest  worst tick\r\n");
+    for (int i = 0; i < PROFILE_ZONES; i++) {
+        uint32_t calls = 0, shortest = UINT32_MAX, longest = 0, worst = 0;
+        uint64_t total = 0;
+        for (int f = 0; f < PROFILE_FRAMES; f++) {
+            const profile_zone *z = &p->frames[f][i];
+            calls += z->calls;
+            total += z->total;
+            if (z->calls > 0 && z->shortest < shortest) {
+                shortest = z->shortest;
+            }
+            if (z->longest > longest) {
+                longest = z->longest;
+            }
+            if (z->total > worst) {
+                worst = z->total;
+            }
+        }
+        if (calls == 0) {
+            printf("%-15s %7u\r\n", zone_names[i], 0u);
+            continue;
+        }
+        printf("%-15s %7u %10u %10u %10u  %10u\r\n", zone_names[i], (unsigned int)calls, (unsigned int)shortest,
+               (unsigned int)(total / calls), (unsigned int)longest, (unsigned int)worst);
+    }
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+@file profile.h
+@brief Counts the cycles spent in each zone of SPACEGAME's code, tick by tick.
+@brief A zone is timed from where PROFILE_ZONE() is written to the end of the enclosing block, including any
+@brief zones inside it. Each tick's calls and their shortest, total and longest times are kept for every zone in
+@brief a ring of the last PROFILE_FRAMES ticks, and profile_dump() prints them summed over the ring. Timing a zone
+@brief is two reads of the counter and a few adds and compares, so profiling can be left on. With PROFILE set to 0
+@brief the zones and the ring compile away to nothing.
+@brief The K64F counts core cycles with the DWT cycle counter. The host counts with the time stamp counter on x86,
+@brief and in nanoseconds from std::chrono::steady_clock elsewhere.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "mbed.h"
+#include "scheduler.h"
+
+#ifndef PROFILE
+#define PROFILE 1               /*!< 0 compiles the zones out */
+#endif
+
+#define PROFILE_SHIP 0          /*!< shipcontrol() */
+#define PROFILE_SHOOT 1         /*!< shoot() */
+#define PROFILE_ENEMY_SHOOT 2   /*!< enemy_shoot() */
+#define PROFILE_MOVEMENT 3      /*!< movement() */
+#define PROFILE_BOSS 4          /*!< boss_movement() */
+#define PROFILE_PAINT 5         /*!< paint_character() */
+#define PROFILE_HUD 6           /*!< hud_update() */
+#define PROFILE_REFRESH 7       /*!< The display refreshes in main.cpp, each frame started in the main loop and the whole of the blocking ones */
+#define PROFILE_ZONES 8
+
+#define PROFILE_FRAMES 64       /*!< Ticks kept in the ring */
+
+#if PROFILE
+
+#if defined(TARGET_K64F)
+inline uint32_t profile_counter()
+{
+    return DWT->CYCCNT;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint32_t profile_counter()
+{
+    return (uint32_t)__rdtsc();
+}
+#else
+#include <chrono>
+inline uint32_t profile_counter()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+/**
+A zone's times in one tick
+@param calls - times the zone was entered
+@param shortest - fewest cycles in one call
+@param total - cycles in all the calls
+@param longest - most cycles in one call
+*/
+struct profile_zone {
+    uint32_t calls;
+    uint32_t shortest;
+    uint32_t total;
+    uint32_t longest;
+};
+
+/**
+The ring of ticks
+@param frames - each zone's times in each tick
+@param current - the tick being added to
+@param ticks - ticks since profile_init(), so the dump knows how much of the ring is filled
+*/
+struct profile_ring {
+    profile_zone frames[PROFILE_FRAMES][PROFILE_ZONES];
+    int current;
+    uint32_t ticks;
+};
+
+extern GAME_LOCAL profile_ring g_profile;   // defined in profile.cpp
+
+/**
+Adds a call of a zone to the current tick
+@param zone - the zone, one of PROFILE_SHIP to PROFILE_REFRESH
+@param cycles - the time the call took
+*/
+inline void profile_add(int zone, uint32_t cycles)
+{
+    profile_zone *z = &g_profile.frames[g_profile.current][zone];
+    z->calls++;
+    z->total += cycles;
+    if (cycles < z->shortest) {
+        z->shortest = cycles;
+    }
+    if (cycles > z->longest) {
+        z->longest = cycles;
+    }
+}
+
+/** Times a zone from its construction to the end of the block it is declared in */
+class profile_scope
+{
+public:
+    profile_scope(int zone) : _zone(zone), _start(profile_counter()) {}
+    ~profile_scope() {
+        profile_add(_zone, profile_counter() - _start);
+    }
+private:
+    int _zone;
+    uint32_t _start;
+};
+
+#define PROFILE_JOIN(a, b) a##b
+#define PROFILE_NAME(line) PROFILE_JOIN(profile_scope_, line)
+#define PROFILE_ZONE(zone) profile_scope PROFILE_NAME(__LINE__)(zone)   /*!< Times the rest of the block as the zone */
+
+/**
+Starts the cycle counter and empties the ring
+*/
+void profile_init();
+
+/**
+Moves on to the next tick in the ring, called by the main loop at the start of each tick
+*/
+void profile_tick();
+
+/**
+Prints each zone's calls and their shortest, mean and longest times over the ticks in the ring, and the most
+time it took in any one tick
+*/
+void profile_dump();
+
+#else
+
+#define PROFILE_ZONE(zone)
+
+inline void profile_init() {}
+inline void profile_tick() {}
+inline void profile_dump() {}
+
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+@file projectile.cpp
+
+@brief Bullet pool implementation
+
+*/
+
+#include "mbed.h"
+#include "N5110.h"
+#include "projectile.h"
+
+void projectile_init(projectile_pool *pool)
+{
+    projectile_clear(pool);
+    pool->high_water = 0;
+    pool->dropped = 0;
+}
+
+void projectile_clear(projectile_pool *pool)
+{
+    pool->count = 0;
+}
+
+projectile *projectile_spawn(projectile_pool *pool, int x, int y, int dx, int owner)
+{
+    if (pool->count == PROJECTILE_MAX) {
+        pool->dropped++;
+        return NULL;
+    }
+    projectile *p = &pool->live[pool->count++];
+    p->x = x;
+    p->from = x;
+    p->y = y;
+    p->dx = dx;
+    p->length = 0;
+    p->owner = owner;
+    if (pool->count > pool->high_water) {
+        pool->high_water = pool->count;
+    }
+    return p;
+}
+
+void projectile_free(projectile_pool *pool, int index)
+{
+    pool->live[index] = pool->live[--pool->count];
+}
+
+// the head has left the screen once it reaches the column past the edge it is heading for
+static int off_screen(const projectile *p)
+{
+    return (p->dx > 0) ? p->x >= WIDTH : p->x <= -1;
+}
+
+int projectile_step(projectile *p, N5110 *lcd)
+{
+    p->from = p->x;
+    for (int i = 0; i < PROJECTILE_SPEED; i++) {
+        if (off_screen(p) && p->length == 0) {
+            break;                                          // spent
+        }
+        if (!off_screen(p)) {
+            lcd->setPixel(p->x, p->y);                      // head of the bullet
+        }
+        if (p->length == PROJECTILE_LENGTH || off_screen(p)) {
+            lcd->clearPixel(p->x - p->dx * p->length, p->y);    // end of the trail
+            if (off_screen(p) && p->length > 0) {
+                p->length--;                                // shrink so it doesn't disappear all at once
+            }
+        } else {
+            p->length++;
+        }
+        if (!off_screen(p)) {
+            p->x += p->dx;
+        }
+    }
+    return p->length;
+}
+
+// the head is drawn at each column before the one it is moved on to, so one column behind p->from up to one
+// behind p->x
+void projectile_swept(const projectile *p, int *x0, int *x1)
+{
+    int start = p->from - p->dx;
+    int end = p->x - p->dx;
+    *x0 = start < end ? start : end;
+    *x1 = start < end ? end : start;
+}
+
+void projectile_erase(projectile *p, N5110 *lcd)
+{
+    for (int j = 0; j <= p->length; j++) {
+        lcd->clearPixel(p->x - p->dx * j, p->y);
+    }
+    p->length = 0;
+}
@@ -0,0 +1,116 @@
+/**
+@file projectile.h
+@brief Fixed-capacity pool of bullets for SPACEGAME, shared by the player and the enemies.
+@brief Live bullets are kept packed at the front of the array, so updates only visit bullets that are flying and
+@brief the free slots are everything after the last one. Firing takes the first free slot and a spent bullet is
+@brief replaced by the last live one, both in constant time.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef PROJECTILE_H
+#define PROJECTILE_H
+
+#include "N5110.h"
+#include "entity.h"
+
+#define PROJECTILE_MAX 48       /*!< Maximum number of bullets in flight at once */
+#define PROJECTILE_LENGTH 3     /*!< Length of the trail of a bullet in pixels */
+#define PROJECTILE_PLAYER 0xFFFF /*!< Owner of bullets fired by the player, enemies own theirs by their number */
+#ifndef PROJECTILE_SPEED
+#define PROJECTILE_SPEED 2      /*!< Pixels a bullet moves each time it is stepped, can be set when building */
+#endif
+
+#if ENTITY_MAX >= PROJECTILE_PLAYER
+#error "projectile: an enemy's number would be taken for the player's"
+#endif
+
+/**
+A bullet in flight
+@param x - x-coordinate of the head of the bullet
+@param from - x-coordinate of the head before the bullet was last stepped
+@param y - y-coordinate of the bullet
+@param dx - direction of travel, 1 for right and -1 for left
+@param length - current length of the trail, 0 once the bullet is spent
+@param owner - who fired it, PROJECTILE_PLAYER or the number of the enemy
+*/
+struct projectile {
+    short x;
+    short from;
+    short y;
+    signed char dx;
+    unsigned char length;
+    uint16_t owner;
+};
+
+/**
+The pool
+@param live - the bullets in flight are live[0] to live[count - 1]
+@param count - number of bullets in flight
+@param high_water - most bullets that have been in flight at once
+@param dropped - bullets not fired because the pool was full
+*/
+struct projectile_pool {
+    projectile live[PROJECTILE_MAX];
+    int count;
+    int high_water;
+    int dropped;
+};
+
+/**
+Empties the pool, without drawing anything
+@param pool - the pool
+*/
+void projectile_init(projectile_pool *pool);
+
+/**
+Drops every bullet, without drawing anything. The high water mark and dropped count are kept.
+@param pool - the pool
+*/
+void projectile_clear(projectile_pool *pool);
+
+/**
+Fires a bullet, it is drawn the first time it is stepped
+@param pool - the pool
+@param x - x-coordinate to fire from
+@param y - y-coordinate to fire from
+@param dx - direction of travel, 1 for right and -1 for left
+@param owner - who fired it
+@returns the new bullet, or NULL if the pool is full
+*/
+projectile *projectile_spawn(projectile_pool *pool, int x, int y, int dx, int owner);
+
+/**
+Removes a bullet from the pool by moving the last live bullet into its slot, so the bullet after it is now at index
+@param pool - the pool
+@param index - index of the bullet in live[]
+*/
+void projectile_free(projectile_pool *pool, int index);
+
+/**
+Moves a bullet PROJECTILE_SPEED pixels, drawing its head and clearing the end of its trail as it goes. Once its
+head is off the screen the trail shortens each pixel until the bullet is spent.
+@param p - the bullet
+@param lcd - display to draw on
+@returns the length of the trail, 0 when the bullet is spent
+*/
+int projectile_step(projectile *p, N5110 *lcd);
+
+/**
+Finds the columns the head of a bullet has been drawn in since it was last stepped, and the one it was drawn in
+before that, where a target that has moved into its path since then would be hit
+@param p - the bullet
+@param x0 - set to the leftmost of the columns
+@param x1 - set to the rightmost
+*/
+void projectile_swept(const projectile *p, int *x0, int *x1);
+
+/**
+Clears the whole trail of a bullet from the display and marks it as spent
+@param p - the bullet
+@param lcd - display to draw on
+*/
+void projectile_erase(projectile *p, N5110 *lcd);
+
+#endif
@@ -0,0 +1,252 @@
+/**
+@file replay.cpp
+
+@brief Input recording and replay implementation
+
+*/
+
+#include "mbed.h"
+#include "scheduler.h"
+#include "replay.h"
+
+#define REPLAY_MAGIC "IR"
+#define REPLAY_HEADER 7         // magic, version and seed
+
+// each change is the ticks since the last change, 7 bits to a byte with the top bit set on all but the last,
+// then a byte holding the new inputs, then the speed if it changed
+#define REPLAY_FIRE 0x20
+#define REPLAY_BUTTON 0x10
+#define REPLAY_SPEED 0x40       // the speed follows
+#define REPLAY_END 0x80         // the recording ended on this tick
+
+#define REPLAY_OFF 0
+#define REPLAY_RECORDING 1
+#define REPLAY_PLAYING 2
+
+/**
+The recording or replay in progress
+@param mode - REPLAY_OFF, REPLAY_RECORDING or REPLAY_PLAYING
+@param started - 1 once the game has given its seed, until the recording is closed
+@param sink - where the recording goes
+@param buffer - bytes of the recording waiting for the sink
+@param head - bytes put in the buffer, counting on past its size
+@param tail - bytes taken by the sink
+@param dropped - bytes lost because the sink fell behind, the recording is spoiled if any were
+@param data - the recording being replayed
+@param length - length of the recording in bytes
+@param next - the next byte to be replayed
+@param due - tick of the next change to be replayed
+@param finished - 1 once the replay has reached the end of the recording
+@param tick - tick of the last change
+@param last - the inputs after the last change
+@param changes - number of changes recorded or replayed
+*/
+struct replay {
+    int mode;
+    int started;
+    replay_sink sink;
+    unsigned char buffer[REPLAY_BUFFER];
+    unsigned int head;
+    unsigned int tail;
+    long dropped;
+    const unsigned char *data;
+    int length;
+    int next;
+    unsigned int due;
+    int finished;
+    unsigned int tick;
+    input_state last;
+    long changes;
+};
+
+static GAME_LOCAL replay s_replay;
+
+static void put_byte(replay *r, int byte)
+{
+    if (r->head - r->tail == REPLAY_BUFFER) {
+        r->dropped++;
+        return;
+    }
+    r->buffer[r->head & (REPLAY_BUFFER - 1)] = byte;
+    r->head++;
+}
+
+static void put_change(replay *r, unsigned int tick, int byte)
+{
+    unsigned int delta = tick - r->tick;
+    while (delta >= 0x80) {
+        put_byte(r, (delta & 0x7F) | 0x80);
+        delta >>= 7;
+    }
+    put_byte(r, delta);
+    put_byte(r, byte);
+    r->tick = tick;
+}
+
+static int get_byte(replay *r)
+{
+    if (r->next >= r->length) {
+        r->finished = 1;    // a recording cut short ends where it was cut
+        return REPLAY_END;
+    }
+    return r->data[r->next++];
+}
+
+// reads the ticks until the next change, leaving its inputs to be read when it is due
+static void get_due(replay *r)
+{
+    unsigned int delta = 0;
+    int byte;
+    int shift = 0;
+    do {
+        byte = get_byte(r);
+        delta |= (byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && !r->finished && shift < 35);
+    r->due = r->tick + delta;
+}
+
+void replay_record(replay_sink sink)
+{
+    memset(&s_replay, 0, sizeof(s_replay));
+    s_replay.mode = REPLAY_RECORDING;
+    s_replay.sink = sink;
+}
+
+int replay_play(const unsigned char *data, int length)
+{
+    memset(&s_replay, 0, sizeof(s_replay));
+    for (int n = 0; n + REPLAY_HEADER <= length; n++) {
+        if (data[n] == REPLAY_MAGIC[0] && data[n + 1] == REPLAY_MAGIC[1] && data[n + 2] == REPLAY_VERSION) {
+            s_replay.mode = REPLAY_PLAYING;
+            s_replay.data = data;
+            s_replay.length = length;
+            s_replay.next = n + 3;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int replay_active()
+{
+    return s_replay.mode != REPLAY_OFF;
+}
+
+uint32_t replay_seed(uint32_t seed)
+{
+    replay *r = &s_replay;
+    if (r->mode == REPLAY_RECORDING) {
+        put_byte(r, REPLAY_MAGIC[0]);
+        put_byte(r, REPLAY_MAGIC[1]);
+        put_byte(r, REPLAY_VERSION);
+        for (int i = 0; i < 32; i += 8) {
+            put_byte(r, (seed >> i) & 0xFF);
+        }
+    } else if (r->mode == REPLAY_PLAYING) {
+        seed = 0;
+        for (int i = 0; i < 32; i += 8) {
+            seed |= (uint32_t)r->data[r->next++] << i;
+        }
+        get_due(r);
+    }
+    r->started = r->mode != REPLAY_OFF;
+    return seed;
+}
+
+void replay_input(input_state *in, unsigned int tick)
+{
+    replay *r = &s_replay;
+    if (!r->started) {
+        return;
+    }
+
+    if (r->mode == REPLAY_RECORDING) {
+        if (in->dx != r->last.dx || in->dy != r->last.dy || in->speed != r->last.speed ||
+                in->button != r->last.button || in->fire) {
+            int speed = in->speed != r->last.speed;
+            put_change(r, tick, (in->dx + 1) | (in->dy + 1) << 2 | (in->button ? REPLAY_BUTTON : 0) |
+                       (in->fire ? REPLAY_FIRE : 0) | (speed ? REPLAY_SPEED : 0));
+            if (speed) {
+                put_byte(r, in->speed);
+            }
+            r->last = *in;
+            r->changes++;
+        }
+        return;
+    }
+
+    r->last.fire = 0;
+    while (!r->finished && (int)(tick - r->due) >= 0) {
+        int byte = get_byte(r);
+        if (byte & REPLAY_END) {
+            r->finished = 1;
+            break;
+        }
+        r->last.dx = (byte & 3) - 1;
+        r->last.dy = ((byte >> 2) & 3) - 1;
+        r->last.button = (byte & REPLAY_BUTTON) != 0;
+        r->last.fire |= (byte & REPLAY_FIRE) != 0;      // presses on ticks the game didn't see are kept for the next
+        if (byte & REPLAY_SPEED) {
+            r->last.speed = get_byte(r);
+        }
+        r->tick = r->due;
+        r->changes++;
+        get_due(r);
+    }
+    *in = r->last;
+}
+
+int replay_next_tick(unsigned int *tick)
+{
+    const replay *r = &s_replay;
+    if (r->mode != REPLAY_PLAYING || !r->started || r->finished) {
+        return 0;
+    }
+    *tick = r->due;
+    return 1;
+}
+
+void replay_drain()
+{
+    replay *r = &s_replay;
+    while (r->mode == REPLAY_RECORDING && r->tail != r->head) {
+        int start = r->tail & (REPLAY_BUFFER - 1);
+        int length = r->head - r->tail;
+        if (start + length > REPLAY_BUFFER) {
+            length = REPLAY_BUFFER - start;     // up to the end of the buffer, the rest follows from the start
+        }
+        int taken = r->sink(&r->buffer[start], length);
+        r->tail += taken;
+        if (taken < length) {
+            break;
+        }
+    }
+}
+
+void replay_close(unsigned int tick)
+{
+    replay *r = &s_replay;
+    if (r->mode == REPLAY_PLAYING && !r->finished && (int)(tick - r->due) >= 0 &&
+            r->next < r->length && (r->data[r->next] & REPLAY_END)) {
+        r->finished = 1;    // the game ended where the recording did
+    }
+    if (r->mode != REPLAY_RECORDING || !r->started) {
+        return;
+    }
+    put_change(r, tick, REPLAY_END);
+    r->started = 0;
+    while (r->tail != r->head) {
+        replay_drain();
+    }
+}
+
+void replay_print_stats()
+{
+    const replay *r = &s_replay;
+    if (r->mode == REPLAY_RECORDING) {
+        printf("recording: %ld changes in %u bytes, %ld dropped\r\n", r->changes, r->head, r->dropped);
+    } else if (r->mode == REPLAY_PLAYING) {
+        printf("replay: %ld changes played, %s\r\n", r->changes, r->finished ? "to the end" : "not finished");
+    }
+}
@@ -0,0 +1,103 @@
+/**
+@file replay.h
+@brief The inputs of SPACEGAME as the game sees them, read once each scheduler tick, and recording and replay of them.
+@brief A recording holds the seed of the game's random number generator and then only the ticks at which the
+@brief inputs changed, so a few bytes cover a second of play. It is passed a few bytes at a time to a sink, such as
+@brief the serial port, from a buffer filled as the game plays. Replaying a recording gives the game the same seed
+@brief and the same inputs on the same ticks, so it plays the same game, as long as the board kept up with every
+@brief tick while recording (no overruns in sched_print_stats()).
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+
+#define REPLAY_VERSION 2        /*!< Changes whenever the layout of a recording changes */
+#define REPLAY_BUFFER 256       /*!< Bytes of recording waiting for the sink, a power of two */
+
+/**
+The inputs for one tick
+@param dx - joystick across, -1 left, 0 centred or 1 right
+@param dy - joystick up and down, -1 up, 0 centred or 1 down
+@param speed - scheduler ticks between ship moves, set with the potentiometer
+@param button - 1 while the button on the PCB is held down
+@param fire - 1 if the button was pressed since the last tick
+*/
+struct input_state {
+    signed char dx;
+    signed char dy;
+    unsigned char speed;
+    unsigned char button;
+    unsigned char fire;
+};
+
+/**
+Function that takes bytes of a recording
+@param data - the bytes
+@param length - number of bytes
+@returns number of bytes taken, the rest are offered again later
+*/
+typedef int (*replay_sink)(const unsigned char *data, int length);
+
+/**
+Records the next game, its seed is written when the game calls replay_seed()
+@param sink - where the recording goes
+*/
+void replay_record(replay_sink sink);
+
+/**
+Replays a recording in the next game instead of reading the inputs. Anything before the start of the
+recording, such as text printed on the same serial port, is skipped.
+@param data - the recording, kept until the game is over
+@param length - length of the recording in bytes
+@returns 1 if a recording was found, 0 if not
+*/
+int replay_play(const unsigned char *data, int length);
+
+/**
+@returns 1 if a game is being recorded or replayed
+*/
+int replay_active();
+
+/**
+Starts the recording or replay at the beginning of a game
+@param seed - seed the game would use
+@returns the seed to use, the recorded one when replaying
+*/
+uint32_t replay_seed(uint32_t seed);
+
+/**
+Records the inputs for a tick, or replaces them with the recorded ones when replaying
+@param in - the inputs read from the board
+@param tick - the scheduler tick they were read on
+*/
+void replay_input(input_state *in, unsigned int tick);
+
+/**
+Finds the tick of the next change being replayed, so that the inputs can be read on it as they were when recording
+@param tick - set to the tick
+@returns 1 if a replay has changes still to come, 0 if not
+*/
+int replay_next_tick(unsigned int *tick);
+
+/**
+Passes as much of the recording as the sink will take, called each time round the main loop
+*/
+void replay_drain();
+
+/**
+Ends the recording and passes all of it to the sink, or notes whether a replay reached the end of its recording
+@param tick - the scheduler tick the game ended on
+*/
+void replay_close(unsigned int tick);
+
+/**
+Prints the size of the recording, or how far the replay got
+*/
+void replay_print_stats();
+
+#endif
@@ -0,0 +1,221 @@
+/**
+@file sampler.cpp
+
+@brief Input sampler implementation
+
+*/
+
+#include "mbed.h"
+#include "scheduler.h"
+#include "sampler.h"
+
+#define DEAD_ZONE ((int)(SAMPLER_DEAD_ZONE * SAMPLER_FULL_SCALE))
+#define CENTRE (SAMPLER_FULL_SCALE / 2)
+
+/**
+The sampler
+@param x, y, pot - the analogue inputs, only converted here on targets without the PDB
+@param button - the button
+@param events - where the button's edges are queued
+@param level - the button's level after the last edge taken
+@param changed_us - when that edge was
+@param bounces - edges ignored as bounce
+*/
+struct sampler {
+    AnalogIn *x;
+    AnalogIn *y;
+    AnalogIn *pot;
+    InterruptIn *button;
+    isr_queue *events;
+    int level;
+    uint32_t changed_us;
+    unsigned int bounces;
+};
+
+static GAME_LOCAL sampler s_sampler;
+
+#if defined(TARGET_K64F)
+
+#define ADC0_DMA_SOURCE 40      // DMAMUX request sources of the ADCs
+#define ADC1_DMA_SOURCE 41
+#define ADC0_DMA_CHANNEL 14     // channels at the top, clear of the ones mbed hands out from the bottom
+#define ADC1_DMA_CHANNEL 15
+#define DMA_SIZE_32 2           // ATTR transfer size of a 32-bit word
+#define PDB_SOFTWARE_TRIGGER 15
+
+// PTB2 and PTB3 are channels 12 and 13 of ADC0, PTB10 is channel 14 of ADC1
+#define JOY_X_CHANNEL 12
+#define JOY_Y_CHANNEL 13
+#define POT_CHANNEL 14
+
+// the DMA wraps its writes within each ring, so a ring is aligned to its size
+static uint32_t s_adc0_ring[2*SAMPLER_WINDOW] __attribute__((aligned(8*SAMPLER_WINDOW)));     // x and y in turn
+static uint32_t s_adc1_ring[SAMPLER_WINDOW] __attribute__((aligned(4*SAMPLER_WINDOW)));       // the pot
+
+static int log2_bytes(int bytes)
+{
+    int n = 0;
+    while ((1 << n) < bytes) {
+        n++;
+    }
+    return n;
+}
+
+// copies each result into the ring without the processor, for ever
+// source_words is how many result registers it reads in turn, starting at R[0]
+static void dma_ring(int channel, int source, ADC_Type *adc, int source_words, uint32_t *ring, int ring_bytes)
+{
+    DMA0->TCD[channel].SADDR = (uint32_t)&adc->R[0];
+    DMA0->TCD[channel].SOFF = source_words > 1 ? 4 : 0;
+    DMA0->TCD[channel].SLAST = 0;
+    DMA0->TCD[channel].DADDR = (uint32_t)ring;
+    DMA0->TCD[channel].DOFF = 4;
+    DMA0->TCD[channel].DLAST_SGA = 0;       // the address modulo wraps both addresses, so nothing is adjusted at the end
+    DMA0->TCD[channel].ATTR = DMA_ATTR_SMOD(source_words > 1 ? log2_bytes(4*source_words) : 0) |
+                              DMA_ATTR_SSIZE(DMA_SIZE_32) | DMA_ATTR_DMOD(log2_bytes(ring_bytes)) |
+                              DMA_ATTR_DSIZE(DMA_SIZE_32);
+    DMA0->TCD[channel].NBYTES_MLNO = 4;     // one result each time the ADC asks
+    DMA0->TCD[channel].CITER_ELINKNO = ring_bytes / 4;
+    DMA0->TCD[channel].BITER_ELINKNO = ring_bytes / 4;
+    DMA0->TCD[channel].CSR = 0;             // stays enabled at the end of each loop, and doesn't interrupt
+    DMAMUX->CHCFG[channel] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(source);
+    DMA0->SERQ = channel;
+}
+
+static void start_conversions()
+{
+    SIM->SCGC6 |= SIM_SCGC6_PDB_MASK | SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    for (int i = 0; i < SAMPLER_WINDOW; i++) {     // centred until the first conversions land
+        s_adc0_ring[2*i] = s_adc0_ring[2*i + 1] = s_adc1_ring[i] = CENTRE;
+    }
+    dma_ring(ADC0_DMA_CHANNEL, ADC0_DMA_SOURCE, ADC0, 2, s_adc0_ring, sizeof(s_adc0_ring));
+    dma_ring(ADC1_DMA_CHANNEL, ADC1_DMA_SOURCE, ADC1, 1, s_adc1_ring, sizeof(s_adc1_ring));
+
+    // AnalogIn has calibrated the ADCs and set them to 16 bits, now each converts when the PDB triggers it
+    ADC0->SC3 &= ~ADC_SC3_ADCO_MASK;
+    ADC1->SC3 &= ~ADC_SC3_ADCO_MASK;
+    ADC0->SC1[0] = ADC_SC1_ADCH(JOY_X_CHANNEL);
+    ADC0->SC1[1] = ADC_SC1_ADCH(JOY_Y_CHANNEL);
+    ADC1->SC1[0] = ADC_SC1_ADCH(POT_CHANNEL);
+    ADC0->SC2 |= ADC_SC2_ADTRG_MASK | ADC_SC2_DMAEN_MASK;
+    ADC1->SC2 |= ADC_SC2_ADTRG_MASK | ADC_SC2_DMAEN_MASK;
+
+    // the PDB runs from the bus clock, which divides down from the same clock as the core
+    uint32_t outdiv1 = (SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV1_MASK) >> SIM_CLKDIV1_OUTDIV1_SHIFT;
+    uint32_t outdiv2 = (SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV2_MASK) >> SIM_CLKDIV1_OUTDIV2_SHIFT;
+    uint32_t bus_hz = SystemCoreClock * (outdiv1 + 1) / (outdiv2 + 1);
+
+    PDB0->SC = PDB_SC_PDBEN_MASK | PDB_SC_CONT_MASK | PDB_SC_TRGSEL(PDB_SOFTWARE_TRIGGER);
+    PDB0->MOD = bus_hz / SAMPLER_RATE - 1;      // fits in 16 bits without the prescaler up to a 65 MHz bus
+    PDB0->IDLY = 0;
+    PDB0->CH[0].DLY[0] = 0;
+    PDB0->CH[0].C1 = PDB_C1_EN(3) | PDB_C1_TOS(1) | PDB_C1_BB(2);     // x at the start of each period, then y straight after
+    PDB0->CH[1].DLY[0] = 0;
+    PDB0->CH[1].C1 = PDB_C1_EN(1) | PDB_C1_TOS(1);                    // the pot alongside on the other ADC
+    PDB0->SC |= PDB_SC_LDOK_MASK;
+    PDB0->SC |= PDB_SC_SWTRIG_MASK;
+}
+
+static void read_analogue(sampler_state *state)
+{
+    uint32_t x = 0, y = 0, pot = 0;
+    for (int i = 0; i < SAMPLER_WINDOW; i++) {
+        x += s_adc0_ring[2*i] & 0xFFFF;
+        y += s_adc0_ring[2*i + 1] & 0xFFFF;
+        pot += s_adc1_ring[i] & 0xFFFF;
+    }
+    state->x = (int)(x / SAMPLER_WINDOW) - CENTRE;
+    state->y = (int)(y / SAMPLER_WINDOW) - CENTRE;
+    state->pot = pot / SAMPLER_WINDOW;
+}
+
+#else
+
+static void start_conversions()
+{
+}
+
+static void read_analogue(sampler_state *state)
+{
+    sampler *s = &s_sampler;
+    state->x = (int)s->x->read_u16() - CENTRE;
+    state->y = (int)s->y->read_u16() - CENTRE;
+    state->pot = s->pot->read_u16();
+}
+
+#endif
+
+// takes an edge as the button's new level, and starts the time in which further edges are bounce
+static void button_changed(int level, uint32_t now)
+{
+    sampler *s = &s_sampler;
+    s->level = level;
+    s->changed_us = now;
+    isr_queue_push(s->events, ISR_BUTTON, level, now);
+}
+
+static void button_edge(int level)
+{
+    sampler *s = &s_sampler;
+    uint32_t now = us_ticker_read();
+    if (now - s->changed_us < SAMPLER_DEBOUNCE_US) {
+        s->bounces++;
+    } else if (level != s->level) {
+        button_changed(level, now);
+    }
+}
+
+static void button_rise_isr()
+{
+    button_edge(1);
+}
+
+static void button_fall_isr()
+{
+    button_edge(0);
+}
+
+void sampler_init(AnalogIn *x, AnalogIn *y, AnalogIn *pot, InterruptIn *button, isr_queue *events)
+{
+    sampler *s = &s_sampler;
+    s->x = x;
+    s->y = y;
+    s->pot = pot;
+    s->button = button;
+    s->events = events;
+    s->level = button->read();
+    s->changed_us = us_ticker_read() - SAMPLER_DEBOUNCE_US;    // the first edge is taken straight away
+    s->bounces = 0;
+    button->rise(&button_rise_isr);
+    button->fall(&button_fall_isr);
+    start_conversions();
+}
+
+static int dead_zone(int value)
+{
+    return value > DEAD_ZONE || value < -DEAD_ZONE ? value : 0;
+}
+
+void sampler_read(sampler_state *state)
+{
+    sampler *s = &s_sampler;
+    read_analogue(state);
+    state->x = dead_zone(state->x);
+    state->y = dead_zone(state->y);
+
+    // the edge interrupt is held off while the main loop stands in for it, so the two can't both take one edge
+    __disable_irq();
+    uint32_t now = us_ticker_read();
+    int level = s->button->read();
+    if (level != s->level && now - s->changed_us >= SAMPLER_DEBOUNCE_US) {
+        button_changed(level, now);
+    }
+    __enable_irq();
+}
+
+unsigned int sampler_bounces()
+{
+    return s_sampler.bounces;
+}
@@ -0,0 +1,63 @@
+/**
+@file sampler.h
+@brief Samples the joystick and potentiometer of SPACEGAME in the background and debounces the button on the PCB.
+@brief On the K64F the PDB starts a conversion of each analogue input SAMPLER_RATE times a second and the DMA copies
+@brief the results into a ring for each ADC, so sampling takes no processor time at all. Reading the inputs averages
+@brief the ring, in fixed point, rather than waiting for three conversions. Other targets, and the host, convert each
+@brief input once when it is read. The joystick is centred on zero with a dead-zone, so the game only has to look
+@brief at the sign. The button's edges are queued to the main loop as they happen, and an edge within
+@brief SAMPLER_DEBOUNCE_US of the last one is taken as contact bounce and ignored.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "mbed.h"
+#include "isr_queue.h"
+
+#define SAMPLER_RATE 1000           /*!< Conversions a second of each analogue input, on the K64F */
+#define SAMPLER_WINDOW 16           /*!< Conversions of each input averaged, a power of two */
+#define SAMPLER_DEAD_ZONE 0.1f      /*!< The joystick reads as centred until it is this far off centre, as a fraction of full scale */
+#define SAMPLER_DEBOUNCE_US 5000    /*!< Edges of the button this soon after the last one are bounce */
+#define SAMPLER_FULL_SCALE 65536    /*!< A value of 1.0 in the fixed point the sampler gives */
+
+/**
+The inputs, as read at one moment
+@param x - joystick x-axis, from -32768 to 32767 with 0 at the centre, 0 anywhere in the dead-zone
+@param y - joystick y-axis, the same
+@param pot - potentiometer, from 0 to 65535 for 0.0 to 1.0
+*/
+struct sampler_state {
+    int x;
+    int y;
+    unsigned int pot;
+};
+
+/**
+Starts sampling. The inputs must have been constructed, which sets their pins up, and on the K64F the ADCs they
+are on are then triggered by the PDB.
+@param x - the joystick's x-axis, PTB2 on the K64F
+@param y - the joystick's y-axis, PTB3 on the K64F
+@param pot - the potentiometer, PTB10 on the K64F
+@param button - the button, each edge that isn't bounce is queued as ISR_BUTTON with the new level
+@param events - where the button's edges are queued
+*/
+void sampler_init(AnalogIn *x, AnalogIn *y, AnalogIn *pot, InterruptIn *button, isr_queue *events);
+
+/**
+Takes the filtered inputs. Also queues the button's level if it changed during the bounce after the last edge,
+so that the main loop doesn't miss a release that came while edges were being ignored.
+@param s - set to the inputs
+*/
+void sampler_read(sampler_state *s);
+
+/**
+Counts the button edges ignored as bounce
+@returns the number since sampler_init()
+*/
+unsigned int sampler_bounces();
+
+#endif
@@ -0,0 +1,224 @@
+/**
+@file scheduler.cpp
+
+@brief Fixed-timestep scheduler implementation
+
+*/
+
+#include "mbed.h"
+#include "scheduler.h"
+
+#define TICK_US ((uint32_t)(SCHED_TICK * 1000000.0f + 0.5f))
+
+static GAME_LOCAL Timeout s_timeout;       // the only hardware timer used by the game, set for the next tick needed
+static GAME_LOCAL Timer s_timer;           // times each run of a task
+static GAME_LOCAL scheduler *s_sched;      // the table the tick interrupt counts down
+
+static void sched_tick_isr();
+
+// sets the timeout for a number of ticks after the last one taken, called with the tick interrupt held off
+static void arm(int ticks)
+{
+    sched_clock *c = &s_sched->clock;
+    c->armed = ticks;
+    int32_t us = (int32_t)(c->tick_us + ticks * TICK_US - us_ticker_read());
+    s_timeout.attach_us(&sched_tick_isr, us > 0 ? us : 1);
+}
+
+// ticks that have come since the last one taken, without an interrupt, rounded down or up
+static int ticks_passed(int round_up)
+{
+    uint32_t us = us_ticker_read() - s_sched->clock.tick_us;
+    return (us + (round_up ? TICK_US - 1 : 0)) / TICK_US;
+}
+
+// ticks from the last one taken to the next one anything needs
+static int next_needed(const scheduler *s)
+{
+    int ticks = s->fixed ? 1 : SCHED_MAX_SKIP;
+    for (int i = 0; i < s->count; i++) {
+        const sched_task *t = &s->tasks[i];
+        if (t->period > 0 && t->countdown < ticks) {
+            ticks = t->countdown;
+        }
+    }
+    if (s->clock.waking && (int)(s->clock.wake - s->ticks) < ticks) {
+        ticks = s->clock.wake - s->ticks;
+    }
+    return ticks;
+}
+
+// counts down each running task by the ticks since the last one taken, and marks it pending when it is due
+static void sched_tick_isr()
+{
+    scheduler *s = s_sched;
+    int elapsed = s->clock.armed;
+    s->clock.tick_us += elapsed * TICK_US;
+    s->ticks += elapsed;
+    s->clock.interrupts++;
+    for (int i = 0; i < s->count; i++) {
+        sched_task *t = &s->tasks[i];
+        if (t->period > 0 && (t->countdown -= elapsed) <= 0) {
+            t->countdown = t->period;
+            if (t->pending) {
+                t->overruns++;      // still hasn't run since it was last due
+            } else {
+                t->due = s->ticks;
+                t->pending = 1;
+                if (s->report) {
+                    isr_queue_push(s->report, ISR_TIMER, i, us_ticker_read());
+                }
+            }
+        }
+    }
+    if (s->clock.waking && (int)(s->clock.wake - s->ticks) <= 0) {
+        s->clock.waking = 0;
+    }
+    arm(next_needed(s));
+}
+
+void sched_init(scheduler *s, void *context)
+{
+    s->count = 0;
+    s->ticks = 0;
+    s->fixed = 0;
+    s->context = context;
+    s->report = 0;
+    s->clock.waking = 0;
+    s->clock.wake = 0;
+    s->clock.interrupts = 0;
+    s->clock.tick_us = us_ticker_read();
+    s_sched = s;
+    s_timer.start();
+    arm(1);
+}
+
+int sched_add(void (*function)(void *context))
+{
+    scheduler *s = s_sched;
+    if (s->count == SCHED_MAX_TASKS) {
+        error("scheduler: too many tasks\n");
+    }
+    sched_task *t = &s->tasks[s->count];
+    t->function = function;
+    t->period = 0;
+    t->countdown = 0;
+    t->pending = 0;
+    t->runs = 0;
+    t->late = 0;
+    t->overruns = 0;
+    t->max_us = 0;
+    return s->count++;
+}
+
+void sched_start(int task, int period)
+{
+    if (period < 1) {
+        period = 1;
+    }
+    __disable_irq();    // the tick interrupt must not see a half-updated entry
+    int countdown = period + ticks_passed(0);     // the tick interrupt counts down from the last tick it took
+    s_sched->tasks[task].period = period;
+    s_sched->tasks[task].countdown = countdown;
+    if (countdown < s_sched->clock.armed) {
+        arm(countdown);     // due before the tick the timeout is set for
+    }
+    __enable_irq();
+}
+
+void sched_stop(int task)
+{
+    __disable_irq();
+    s_sched->tasks[task].period = 0;
+    s_sched->tasks[task].pending = 0;
+    __enable_irq();
+}
+
+void sched_trigger(int task)
+{
+    __disable_irq();
+    if (!s_sched->tasks[task].pending) {
+        s_sched->tasks[task].due = s_sched->ticks;
+        s_sched->tasks[task].pending = 1;
+    }
+    __enable_irq();
+}
+
+void sched_wake(unsigned int tick)
+{
+    __disable_irq();
+    int ticks = tick - s_sched->ticks;
+    int soonest = ticks_passed(1);
+    if (ticks < soonest) {
+        ticks = soonest;    // the tick that comes next is the soonest there is
+    }
+    if (ticks < 1) {
+        ticks = 1;
+    }
+    sched_clock *c = &s_sched->clock;
+    if (!c->waking || ticks < (int)(c->wake - s_sched->ticks)) {
+        c->wake = s_sched->ticks + ticks;
+        c->waking = 1;
+    }
+    if (ticks < c->armed) {
+        arm(ticks);
+    }
+    __enable_irq();
+}
+
+void sched_fixed_tick(int fixed)
+{
+    __disable_irq();
+    s_sched->fixed = fixed;
+    if (fixed && s_sched->clock.armed > 1) {
+        arm(1);
+    }
+    __enable_irq();
+}
+
+int sched_running(int task)
+{
+    return s_sched->tasks[task].period > 0;
+}
+
+int sched_ticks(float seconds)
+{
+    int ticks = (int)(seconds / SCHED_TICK + 0.5f);
+    return (ticks < 1) ? 1 : ticks;
+}
+
+void sched_report(isr_queue *q)
+{
+    s_sched->report = q;
+}
+
+void sched_run()
+{
+    scheduler *s = s_sched;
+    for (int i = 0; i < s->count; i++) {
+        sched_task *t = &s->tasks[i];
+        if (t->pending) {
+            if (s->ticks != t->due) {    // another tick has happened since it became due
+                t->late++;
+            }
+            t->pending = 0;
+            t->runs++;
+            int start = s_timer.read_us();
+            t->function(s->context);
+            int elapsed = s_timer.read_us() - start;
+            if (elapsed > t->max_us) {
+                t->max_us = elapsed;
+            }
+        }
+    }
+}
+
+void sched_print_stats()
+{
+    scheduler *s = s_sched;
+    printf("scheduler: %u ticks of %d ms, %u taken with an interrupt\r\n", s->ticks, (int)(SCHED_TICK * 1000.0f + 0.5f),
+           s->clock.interrupts);
+    for (int i = 0; i < s->count; i++) {
+        printf("task %d: %u runs, %u late, %u overruns, longest %d us\r\n", i, s->tasks[i].runs, s->tasks[i].late, s->tasks[i].overruns, s->tasks[i].max_us);
+    }
+}
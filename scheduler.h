@@ -0,0 +1,164 @@
+/**
+@file scheduler.h
+@brief Fixed-timestep scheduler for SPACEGAME.
+@brief Time is counted in ticks of SCHED_TICK seconds. A single Timeout interrupts on the next tick that a task falls
+@brief due or that sched_wake() has asked for, and the ticks in between are counted without waking the processor,
+@brief so the interrupts taken follow the work there is rather than the tick rate. The interrupt marks the tasks
+@brief that are due, and the main loop then runs them in the order they were added, each to completion. Starting,
+@brief stopping and changing the period of a task only changes its entry in the task table, and the timeout is only
+@brief set again when a task is started with a period shorter than the wait.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "isr_queue.h"
+
+#define SCHED_TICK 0.02f    /*!< Period of the scheduler tick in seconds */
+#define SCHED_MAX_TASKS 8   /*!< Maximum number of tasks */
+#define SCHED_MAX_SKIP 50   /*!< Most ticks counted without an interrupt, so the ticks move on even with nothing to do */
+
+#ifndef GAME_LOCAL
+#define GAME_LOCAL          /*!< Storage class of the game's mutable state, thread_local when the host runs several games at once */
+#endif
+
+/**
+Entry in the task table
+@param function - function run when the task is due
+@param period - period of the task in ticks, 0 when the task is stopped
+@param countdown - ticks until the task is next due
+@param pending - the task is due and waiting for the main loop
+@param due - tick at which the task became due
+@param runs - number of times the task has run
+@param late - number of times the task ran a tick or more after it became due
+@param overruns - number of times the task became due again before it had run, these are lost
+@param max_us - longest time the task has taken to run, in microseconds
+*/
+struct sched_task {
+    void (*function)(void *context);
+    volatile int period;
+    volatile int countdown;
+    volatile int pending;
+    volatile unsigned int due;
+    unsigned int runs;
+    unsigned int late;
+    volatile unsigned int overruns;
+    int max_us;
+};
+
+/**
+Where the tick interrupt is on the clock
+@param tick_us - when the last tick taken was due, every tick keeps to this grid
+@param armed - ticks from that one to the one the timeout is set for
+@param waking - a tick has been asked for with sched_wake()
+@param wake - and which
+@param interrupts - ticks taken with an interrupt
+*/
+struct sched_clock {
+    volatile uint32_t tick_us;
+    volatile int armed;
+    volatile int waking;
+    volatile unsigned int wake;
+    volatile unsigned int interrupts;
+};
+
+/**
+The task table. It is kept with the rest of the state it schedules, so that copying that state copies the timing too.
+Only the Timeout and the Timer the scheduler runs on are kept apart, as hardware.
+@param tasks - the tasks, in the order they were added
+@param count - number of tasks added
+@param ticks - ticks since sched_init()
+@param clock - the tick grid and the tick the timeout is set for
+@param fixed - every tick is taken, as with a fixed ticker
+@param context - passed to every task when it runs
+@param report - where tasks falling due are reported, if anywhere
+*/
+struct scheduler {
+    sched_task tasks[SCHED_MAX_TASKS];
+    int count;
+    volatile unsigned int ticks;
+    sched_clock clock;
+    int fixed;
+    void *context;
+    isr_queue *report;
+};
+
+/**
+Empties a task table and starts the scheduler tick. The other functions all use this table from now on.
+@param s - the table
+@param context - passed to every task when it runs
+*/
+void sched_init(scheduler *s, void *context);
+
+/**
+Adds a task to the table, stopped
+@param function - function to run when the task is due, it is given the context
+@returns the task's number, used for the other functions
+*/
+int sched_add(void (*function)(void *context));
+
+/**
+Starts a task, or restarts it if it is already running, so that it is next due one period from now
+@param task - the task's number
+@param period - period in ticks, at least 1
+*/
+void sched_start(int task, int period);
+
+/**
+Stops a task, dropping it if it is due
+@param task - the task's number
+*/
+void sched_stop(int task);
+
+/**
+Makes a task due straight away, for example from an interrupt. Its period is not changed.
+@param task - the task's number
+*/
+void sched_trigger(int task);
+
+/**
+Makes sure a tick is taken with an interrupt, for work that isn't a task, such as inputs to read or timers on the
+wheel. The main loop sees the tick has moved on when it wakes.
+@param tick - the tick, one that has passed means the next
+*/
+void sched_wake(unsigned int tick);
+
+/**
+Takes every tick with an interrupt, as a fixed ticker would, for comparing the interrupts taken
+@param fixed - 1 to take every tick, 0 to take only the ticks needed
+*/
+void sched_fixed_tick(int fixed);
+
+/**
+@param task - the task's number
+@returns 1 if the task is running, 0 if it is stopped
+*/
+int sched_running(int task);
+
+/**
+Converts a time to a whole number of ticks
+@param seconds - time in seconds
+@returns the nearest number of ticks, at least 1
+*/
+int sched_ticks(float seconds);
+
+/**
+Has the tick interrupt report each task as it falls due, timestamped, for the main loop to see how long tasks wait
+@param q - queue for ISR_TIMER events, or 0 to stop reporting
+*/
+void sched_report(isr_queue *q);
+
+/**
+Runs every task that is due, in the order they were added
+*/
+void sched_run();
+
+/**
+Prints the ticks, runs, late runs, overruns and longest run time of each task
+*/
+void sched_print_stats();
+
+#endif
@@ -0,0 +1,498 @@
+/**
+@file snapshot.cpp
+
+@brief Game snapshot implementation
+
+*/
+
+#include "mbed.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC 0x5347       // "SG"
+
+// the bits that hold any number from 0 to n
+static constexpr int bits_for(unsigned int n)
+{
+    return n == 0 ? 0 : 1 + bits_for(n >> 1);
+}
+
+// bits used by each field, enough for its whole range
+#define BITS_STATE 3
+#define BITS_ALIVE 2
+#define BITS_COORD 8                // signed, positions can be a little off the screen
+#define BITS_SCORE 24               // signed
+#define BITS_LIVES 4
+#define BITS_COUNT (bits_for(ENTITY_MAX) + 1)     // signed, enemies left in the wave
+#define BITS_DIRECTION 2
+#define BITS_TASK 4
+#define BITS_PERIOD 16
+#define BITS_LATENESS 16
+#define BITS_INDEX bits_for(ENTITY_MAX)         // an enemy or a number of enemies
+#define BITS_BULLETS 6
+#define BITS_LENGTH 2
+#define BITS_DUE 16                 // ticks until a timer is due
+#define BITS_BAND 4
+#define BITS_WIDTH 4
+#define BITS_ZERO_RUN 5             // a run of 1 to 32 blank framebuffer bytes
+#define BITS_BYTE 8
+
+#if PROJECTILE_MAX >= (1 << BITS_BULLETS) || SCHED_MAX_TASKS > (1 << BITS_TASK) || \
+    BROAD_BANDS > (1 << BITS_BAND) || PROJECTILE_LENGTH >= (1 << BITS_LENGTH)
+#error "snapshot: a field no longer fits in its bits"
+#endif
+static_assert(BITS_COUNT <= 24, "snapshot: too many enemies to pack a count of them");
+
+// the longest each part of a blob can be, so that SNAPSHOT_MAX_BYTES is checked as the fields change
+#define MAX_SCALAR_BITS (BITS_STATE + BITS_ALIVE + 2 + 2*BITS_COORD + BITS_SCORE + BITS_LIVES + BITS_COUNT + \
+                         BITS_DIRECTION + 32*PRNG_STREAMS + 1 + 32)
+#define MAX_TASK_BITS (5*BITS_TASK + 32 + SCHED_MAX_TASKS*(2*BITS_PERIOD + 1 + BITS_LATENESS))
+#define MAX_BULLET_BITS (BITS_BULLETS + PROJECTILE_MAX*(3*BITS_COORD + 1 + BITS_LENGTH + 1 + BITS_INDEX))
+#define MAX_ENEMY_BITS (BITS_INDEX + 32 + ENTITY_MAX*(3 + 3*BITS_COORD + 1 + WHEEL_KINDS*(1 + BITS_DUE) + 1 + 2*BITS_BAND))
+#define MAX_HUD_BITS (2*(BITS_SCORE + BITS_WIDTH) + 1)
+#define MAX_FRAMEBUFFER_BITS (1 + WIDTH*BANKS*(1 + BITS_BYTE))
+static_assert((24 + MAX_SCALAR_BITS + MAX_TASK_BITS + MAX_BULLET_BITS + MAX_ENEMY_BITS + MAX_HUD_BITS +
+               MAX_FRAMEBUFFER_BITS + 7) / 8 + 2 <= SNAPSHOT_MAX_BYTES, "snapshot: SNAPSHOT_MAX_BYTES is too small");
+
+/**
+Packs fields into bytes, least significant bit first
+@param data - the blob
+@param size - size of the blob in bytes
+@param length - bytes written so far
+@param bits - bits waiting to be written
+@param count - number of bits waiting
+@param overflow - set if the blob was too small or a value didn't fit its bits
+*/
+struct bit_writer {
+    unsigned char *data;
+    int size;
+    int length;
+    uint32_t bits;
+    int count;
+    int overflow;
+};
+
+/**
+Unpacks fields from bytes
+@param data - the blob
+@param size - length of the blob in bytes
+@param length - bytes read so far
+@param bits - bits read but not used yet
+@param count - number of bits not used yet
+@param overflow - set if a field ran past the end of the blob
+*/
+struct bit_reader {
+    const unsigned char *data;
+    int size;
+    int length;
+    uint32_t bits;
+    int count;
+    int overflow;
+};
+
+static void put(bit_writer *w, uint32_t value, int n)   // n is at most 24
+{
+    if (n < 32 && (value >> n) != 0) {
+        w->overflow = 1;
+    }
+    w->bits |= value << w->count;
+    w->count += n;
+    while (w->count >= 8) {
+        if (w->length < w->size) {
+            w->data[w->length] = (unsigned char)w->bits;
+        } else {
+            w->overflow = 1;
+        }
+        w->length++;
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+static void put_signed(bit_writer *w, int value, int n)
+{
+    if (value < -(1 << (n - 1)) || value >= (1 << (n - 1))) {
+        w->overflow = 1;
+    }
+    put(w, (uint32_t)value & ((1U << n) - 1), n);
+}
+
+static void put_word(bit_writer *w, uint32_t value)
+{
+    put(w, value & 0xFFFF, 16);
+    put(w, value >> 16, 16);
+}
+
+static void flush(bit_writer *w)    // pads the last byte with zeros
+{
+    if (w->count > 0) {
+        put(w, 0, 8 - w->count);
+    }
+}
+
+static uint32_t get(bit_reader *r, int n)   // n is at most 24
+{
+    while (r->count < n) {
+        if (r->length < r->size) {
+            r->bits |= (uint32_t)r->data[r->length] << r->count;
+        } else {
+            r->overflow = 1;
+        }
+        r->length++;
+        r->count += 8;
+    }
+    uint32_t value = r->bits & ((1U << n) - 1);
+    r->bits >>= n;
+    r->count -= n;
+    return value;
+}
+
+static int get_signed(bit_reader *r, int n)
+{
+    uint32_t value = get(r, n);
+    return (value & (1U << (n - 1))) ? (int)value - (1 << n) : (int)value;
+}
+
+static uint32_t get_word(bit_reader *r)
+{
+    uint32_t low = get(r, 16);
+    return low | (get(r, 16) << 16);
+}
+
+// Fletcher-16, so that a blob damaged in flash is not restored
+static uint16_t checksum(const unsigned char *data, int length)
+{
+    unsigned int a = 0;
+    unsigned int b = 0;
+    for (int i = 0; i < length; i++) {
+        a = (a + data[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (uint16_t)((b << 8) | a);
+}
+
+// the number of enemies worth saving: past the last one with anything set, every field is zero
+static int enemies_used(const game *g)
+{
+    const entity_store *e = &g->enemies;
+    for (int i = ENTITY_MAX - 1; i >= 0; i--) {
+        if (e->x[i] || e->y[i] || e->length[i] || e->clear_object[i] ||
+                entity_test(e->live, i) || entity_test(e->waiting, i) || entity_test(e->bullet_live, i) ||
+                g->enemy_index.first[i] >= 0 || entity_test(g->timers.pending[WHEEL_SPAWN], i) ||
+                entity_test(g->timers.pending[WHEEL_FIRE], i)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static void save_scalars(bit_writer *w, const game *g)
+{
+    put(w, g->state, BITS_STATE);
+    put(w, g->alive, BITS_ALIVE);
+    put(w, g->new_state, 1);
+    put(w, g->firsttime, 1);
+    put_signed(w, g->ship_x, BITS_COORD);
+    put_signed(w, g->ship_y, BITS_COORD);
+    put_signed(w, g->score, BITS_SCORE);
+    put(w, g->number_lives, BITS_LIVES);
+    put_signed(w, g->no_of_obj, BITS_COUNT);
+    put(w, g->boss_direction, BITS_DIRECTION);
+    for (int i = 0; i < PRNG_STREAMS; i++) {
+        put_word(w, g->random.state[i]);
+    }
+    put(w, g->button_held, 1);
+    if (g->button_held) {
+        put_word(w, g->held_since);
+    }
+}
+
+static void restore_scalars(bit_reader *r, game *g)
+{
+    g->state = get(r, BITS_STATE);
+    g->alive = get(r, BITS_ALIVE);
+    g->new_state = get(r, 1);
+    g->firsttime = get(r, 1);
+    g->ship_x = get_signed(r, BITS_COORD);
+    g->ship_y = get_signed(r, BITS_COORD);
+    g->score = get_signed(r, BITS_SCORE);
+    g->number_lives = get(r, BITS_LIVES);
+    g->no_of_obj = get_signed(r, BITS_COUNT);
+    g->boss_direction = get(r, BITS_DIRECTION);
+    for (int i = 0; i < PRNG_STREAMS; i++) {
+        g->random.state[i] = get_word(r);
+    }
+    g->button_held = get(r, 1);
+    g->held_since = g->button_held ? get_word(r) : 0;
+}
+
+static void save_tasks(bit_writer *w, const game *g)
+{
+    const scheduler *s = &g->sched;
+    put(w, g->task_ship, BITS_TASK);
+    put(w, g->task_fsm, BITS_TASK);
+    put(w, g->task_fire, BITS_TASK);
+    put(w, g->task_bullet, BITS_TASK);
+    put(w, s->count, BITS_TASK);
+    put_word(w, s->ticks);
+    for (int i = 0; i < s->count; i++) {
+        const sched_task *t = &s->tasks[i];
+        put(w, t->period, BITS_PERIOD);
+        put(w, t->countdown, BITS_PERIOD);
+        put(w, t->pending, 1);
+        if (t->pending) {
+            put(w, s->ticks - t->due, BITS_LATENESS);
+        }
+    }
+}
+
+static void restore_tasks(bit_reader *r, game *g)
+{
+    scheduler *s = &g->sched;
+    g->task_ship = get(r, BITS_TASK);
+    g->task_fsm = get(r, BITS_TASK);
+    g->task_fire = get(r, BITS_TASK);
+    g->task_bullet = get(r, BITS_TASK);
+    if ((int)get(r, BITS_TASK) != s->count) {
+        r->overflow = 1;        // saved from a different task table
+        return;
+    }
+    s->ticks = get_word(r);
+    for (int i = 0; i < s->count; i++) {
+        sched_task *t = &s->tasks[i];
+        t->period = get(r, BITS_PERIOD);
+        t->countdown = get(r, BITS_PERIOD);
+        t->pending = get(r, 1);
+        if (t->pending) {
+            t->due = s->ticks - get(r, BITS_LATENESS);
+        }
+    }
+}
+
+static void save_bullets(bit_writer *w, const projectile_pool *pool)
+{
+    put(w, pool->count, BITS_BULLETS);
+    for (int i = 0; i < pool->count; i++) {
+        const projectile *p = &pool->live[i];
+        put_signed(w, p->x, BITS_COORD);
+        put_signed(w, p->from, BITS_COORD);
+        put_signed(w, p->y, BITS_COORD);
+        put(w, p->dx > 0, 1);
+        put(w, p->length, BITS_LENGTH);
+        put(w, p->owner == PROJECTILE_PLAYER, 1);
+        if (p->owner != PROJECTILE_PLAYER) {
+            put(w, p->owner, BITS_INDEX);
+        }
+    }
+}
+
+static void restore_bullets(bit_reader *r, projectile_pool *pool)
+{
+    pool->count = get(r, BITS_BULLETS);
+    if (pool->count > PROJECTILE_MAX) {
+        r->overflow = 1;
+        return;
+    }
+    for (int i = 0; i < pool->count; i++) {
+        projectile *p = &pool->live[i];
+        p->x = get_signed(r, BITS_COORD);
+        p->from = get_signed(r, BITS_COORD);
+        p->y = get_signed(r, BITS_COORD);
+        p->dx = get(r, 1) ? 1 : -1;
+        p->length = get(r, BITS_LENGTH);
+        p->owner = get(r, 1) ? PROJECTILE_PLAYER : get(r, BITS_INDEX);
+        if (p->owner != PROJECTILE_PLAYER && p->owner >= ENTITY_MAX) {
+            r->overflow = 1;
+        }
+    }
+}
+
+static void save_enemies(bit_writer *w, const game *g)
+{
+    const entity_store *e = &g->enemies;
+    int n = enemies_used(g);
+    put(w, n, BITS_INDEX);
+    put_word(w, g->timers.now);
+    for (int i = 0; i < n; i++) {
+        put(w, entity_test(e->live, i), 1);
+        put(w, entity_test(e->waiting, i), 1);
+        put(w, entity_test(e->bullet_live, i), 1);
+        put_signed(w, e->x[i], BITS_COORD);
+        put_signed(w, e->y[i], BITS_COORD);
+        put_signed(w, e->length[i], BITS_COORD);
+        put(w, e->clear_object[i], 1);
+        for (int kind = 0; kind < WHEEL_KINDS; kind++) {
+            int pending = entity_test(g->timers.pending[kind], i);
+            put(w, pending, 1);
+            if (pending) {
+                put(w, g->timers.due[kind * ENTITY_MAX + i] - g->timers.now, BITS_DUE);
+            }
+        }
+        put(w, g->enemy_index.first[i] >= 0, 1);
+        if (g->enemy_index.first[i] >= 0) {
+            put(w, g->enemy_index.first[i], BITS_BAND);
+            put(w, g->enemy_index.last[i], BITS_BAND);
+        }
+    }
+}
+
+static void restore_enemies(bit_reader *r, game *g)
+{
+    entity_store *e = &g->enemies;
+    int n = get(r, BITS_INDEX);
+    if (n > ENTITY_MAX) {
+        r->overflow = 1;
+        return;
+    }
+    memset(e, 0, sizeof(*e));
+    broad_clear(&g->enemy_index);
+    wheel_clear(&g->timers, get_word(r));
+    for (int i = 0; i < n; i++) {
+        if (get(r, 1)) {
+            entity_set(e->live, i);
+        }
+        if (get(r, 1)) {
+            entity_set(e->waiting, i);
+        }
+        if (get(r, 1)) {
+            entity_set(e->bullet_live, i);
+        }
+        e->x[i] = get_signed(r, BITS_COORD);
+        e->y[i] = get_signed(r, BITS_COORD);
+        e->length[i] = get_signed(r, BITS_COORD);
+        e->clear_object[i] = get(r, 1);
+        for (int kind = 0; kind < WHEEL_KINDS; kind++) {
+            if (get(r, 1)) {
+                wheel_set(&g->timers, kind, i, g->timers.now + get(r, BITS_DUE));
+            }
+        }
+        if (get(r, 1)) {
+            int first = get(r, BITS_BAND);
+            int last = get(r, BITS_BAND);
+            if (first > last || last >= BROAD_BANDS) {
+                r->overflow = 1;
+                return;
+            }
+            broad_move(&g->enemy_index, i, first << BROAD_BAND_SHIFT, last << BROAD_BAND_SHIFT);    // the columns fall in the same bands
+        }
+    }
+}
+
+static void save_hud(bit_writer *w, const hud *h)
+{
+    put_signed(w, h->score.shown, BITS_SCORE);
+    put(w, h->score.width, BITS_WIDTH);
+    put_signed(w, h->lives.shown, BITS_SCORE);
+    put(w, h->lives.width, BITS_WIDTH);
+    put(w, h->boundary, 1);
+}
+
+static void restore_hud(bit_reader *r, hud *h)
+{
+    h->score.shown = get_signed(r, BITS_SCORE);
+    h->score.width = get(r, BITS_WIDTH);
+    h->lives.shown = get_signed(r, BITS_SCORE);
+    h->lives.width = get(r, BITS_WIDTH);
+    h->boundary = get(r, 1);
+}
+
+// blank bytes are stored as runs, anything else as it is
+static void save_framebuffer(bit_writer *w, const N5110 *lcd)
+{
+    const unsigned char *bytes = (const unsigned char *)lcd->words;     // the whole buffer, bank after bank
+    int n = 0;
+    while (n < WIDTH*BANKS) {
+        if (bytes[n] == 0) {
+            int run = 1;
+            while (run < (1 << BITS_ZERO_RUN) && n + run < WIDTH*BANKS && bytes[n + run] == 0) {
+                run++;
+            }
+            put(w, 0, 1);
+            put(w, run - 1, BITS_ZERO_RUN);
+            n += run;
+        } else {
+            put(w, 1, 1);
+            put(w, bytes[n], BITS_BYTE);
+            n++;
+        }
+    }
+}
+
+static void restore_framebuffer(bit_reader *r, unsigned char *bytes)
+{
+    int n = 0;
+    while (n < WIDTH*BANKS && !r->overflow) {
+        if (get(r, 1)) {
+            bytes[n++] = get(r, BITS_BYTE);
+        } else {
+            int run = get(r, BITS_ZERO_RUN) + 1;
+            if (n + run > WIDTH*BANKS) {
+                r->overflow = 1;
+                return;
+            }
+            memset(&bytes[n], 0, run);
+            n += run;
+        }
+    }
+}
+
+int snapshot_save(const game *g, const N5110 *lcd, unsigned char *blob, int size)
+{
+    bit_writer w = {blob, size - 2, 0, 0, 0, 0};   // room is left for the checksum
+
+    put(&w, SNAPSHOT_MAGIC, 16);
+    put(&w, SNAPSHOT_VERSION, 8);
+    save_scalars(&w, g);
+    save_tasks(&w, g);
+    save_bullets(&w, &g->bullets);
+    save_enemies(&w, g);
+    save_hud(&w, &g->heads_up);
+    put(&w, lcd != 0, 1);
+    if (lcd) {
+        save_framebuffer(&w, lcd);
+    }
+    flush(&w);
+    if (w.overflow) {
+        return 0;
+    }
+
+    uint16_t sum = checksum(blob, w.length);
+    blob[w.length] = sum & 0xFF;
+    blob[w.length + 1] = sum >> 8;
+    return w.length + 2;
+}
+
+int snapshot_restore(game *g, N5110 *lcd, const unsigned char *blob, int length)
+{
+    if (length < 5 || checksum(blob, length - 2) != (blob[length - 2] | (blob[length - 1] << 8))) {
+        return 0;
+    }
+    bit_reader r = {blob, length - 2, 0, 0, 0, 0};
+    if (get(&r, 16) != SNAPSHOT_MAGIC || get(&r, 8) != SNAPSHOT_VERSION) {
+        return 0;
+    }
+
+    game restored = *g;     // the task functions and the statistics are kept
+    unsigned char bytes[WIDTH*BANKS];
+    restore_scalars(&r, &restored);
+    restore_tasks(&r, &restored);
+    restore_bullets(&r, &restored.bullets);
+    restore_enemies(&r, &restored);
+    restore_hud(&r, &restored.heads_up);
+    int framebuffer = get(&r, 1);
+    if (framebuffer) {
+        restore_framebuffer(&r, bytes);
+    }
+    if (r.overflow) {
+        return 0;
+    }
+
+    __disable_irq();    // the tick interrupt must not see a half-restored task table
+    restored.events = g->events;    // nor lose an event queued since the game was copied
+    restored.sched.clock = g->sched.clock;      // the timeout stays set for the tick it was set for
+    *g = restored;
+    __enable_irq();
+    if (framebuffer && lcd) {
+        lcd->setBuffer(bytes);
+    }
+    return 1;
+}
@@ -0,0 +1,45 @@
+/**
+@file snapshot.h
+@brief Saves a game of SPACEGAME into a small bit-packed blob and restores it exactly, for resuming after power-up
+@brief and, on the host, for rewinding and searching.
+@brief Each field is packed into only as many bits as its range needs, only the enemies and bullets in use are saved,
+@brief and runs of blank bytes in the framebuffer are stored as a count. The scheduler's task functions are not saved,
+@brief so a blob must be restored into a game whose tasks were added in the same order, as main() does. Counters
+@brief kept only for printing statistics (task runs, bullet high water, event waits) are left as they are, and so are
+@brief the inputs, which are read again on the next tick, the events the interrupts have queued and the scheduler's
+@brief clock, which belongs to the board's timeout rather than to the game.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "N5110.h"
+#include "game.h"
+
+#define SNAPSHOT_VERSION 4          /*!< Changes whenever the layout of a blob changes */
+#define SNAPSHOT_MAX_BYTES (900 + (ENTITY_MAX * 71 + 7) / 8)    /*!< Largest possible blob, a full game and a framebuffer with no blank bytes, each enemy taking up to 71 bits */
+
+/**
+Saves a game
+@param g - the game
+@param lcd - the display whose framebuffer is saved with the game, or 0 to leave it out
+@param blob - buffer for the blob
+@param size - size of the buffer in bytes
+@returns the length of the blob in bytes, or 0 if it didn't fit
+*/
+int snapshot_save(const game *g, const N5110 *lcd, unsigned char *blob, int size);
+
+/**
+Restores a game saved by snapshot_save(). Nothing is changed unless the whole blob is valid.
+@param g - the game, its tasks must have been added as they were in the game that was saved
+@param lcd - the display to restore the framebuffer to, only the bytes that change are sent at its next refresh, or 0 to leave it
+@param blob - the blob
+@param length - length of the blob in bytes
+@returns 1 if the game was restored, 0 if the blob was damaged, from a different version or for a different task table
+*/
+int snapshot_restore(game *g, N5110 *lcd, const unsigned char *blob, int length);
+
+#endif
@@ -0,0 +1,151 @@
+/**
+@file sprite.h
+@brief Compile-time conversion of images (lists of x-y coordinate pairs) into sprites packed for N5110::drawSprite().
+@brief The packed columns, bounding box and length of each image are worked out by the compiler, so the sprites
+@brief are constant data kept in flash and nothing about an image has to be typed in by hand.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include "N5110.h"
+
+#define IMAGE_END 99    /*!< x-coordinate that ends an image */
+
+/**
+Structure for creating an image.
+@brief To create an image there must an x-y coordinate pair for each pixel, from a chosen point.
+@param x - x-coordinate from reference
+@param y - y-coordinate from reference
+*/
+struct imagestruct {
+    int x;
+    int y;
+};
+typedef imagestruct image;
+
+constexpr int image_min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+constexpr int image_max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+/**
+Length of an image
+@param points - the image
+@returns the number of points before the IMAGE_END terminator
+*/
+constexpr int image_length(const image *points, int i = 0)
+{
+    return points[i].x == IMAGE_END ? i : image_length(points, i + 1);
+}
+
+// bounding box of the first n points of an image
+constexpr int image_left(const image *points, int n)
+{
+    return n == 1 ? points[0].x : image_min(points[n - 1].x, image_left(points, n - 1));
+}
+
+constexpr int image_right(const image *points, int n)
+{
+    return n == 1 ? points[0].x : image_max(points[n - 1].x, image_right(points, n - 1));
+}
+
+constexpr int image_top(const image *points, int n)
+{
+    return n == 1 ? points[0].y : image_min(points[n - 1].y, image_top(points, n - 1));
+}
+
+constexpr int image_bottom(const image *points, int n)
+{
+    return n == 1 ? points[0].y : image_max(points[n - 1].y, image_bottom(points, n - 1));
+}
+
+#define IMAGE_WIDTH(points) (image_right(points, image_length(points)) - image_left(points, image_length(points)) + 1)
+#define IMAGE_HEIGHT(points) (image_bottom(points, image_length(points)) - image_top(points, image_length(points)) + 1)
+
+// bitmask of the points of the first n points of an image in column x, bit 0 being row top
+constexpr uint16_t image_column(const image *points, int n, int x, int top)
+{
+    return n == 0 ? 0 : image_column(points, n - 1, x, top) | (points[n - 1].x == x ? 1 << (points[n - 1].y - top) : 0);
+}
+
+// list of the column numbers 0 to N-1, used to fill in each column of a sprite
+template <int... I> struct sprite_indices {};
+template <int N, int... I> struct sprite_make_indices : sprite_make_indices<N - 1, N - 1, I...> {};
+template <int... I> struct sprite_make_indices<0, I...> {
+    typedef sprite_indices<I...> type;
+};
+
+/**
+Packed columns of a sprite
+@param columns - bitmask for each column, left to right
+*/
+template <int Width>
+struct sprite_columns {
+    uint16_t columns[Width];
+};
+
+template <int Width, int... I>
+constexpr sprite_columns<Width> image_pack(const image *points, sprite_indices<I...>)
+{
+    return sprite_columns<Width> {{
+            image_column(points, image_length(points), image_left(points, image_length(points)) + I, image_top(points, image_length(points)))...
+        }
+    };
+}
+
+/**
+Defines a sprite, packed from an image at compile time.
+@brief The packed columns are defined as name_columns, and the sprite's reference point is the image's (0,0).
+@param name - name of the sprite
+@param points - the image, which must be constexpr
+*/
+#define SPRITE(name, points) \
+    static_assert(IMAGE_HEIGHT(points) <= SPRITE_MAX_HEIGHT, "image " #points " is too tall for a sprite"); \
+    constexpr sprite_columns<IMAGE_WIDTH(points)> name##_columns = \
+        image_pack<IMAGE_WIDTH(points)>(points, sprite_make_indices<IMAGE_WIDTH(points)>::type()); \
+    constexpr Sprite name = {name##_columns.columns, IMAGE_WIDTH(points), IMAGE_HEIGHT(points), \
+                             -image_left(points, image_length(points)), -image_top(points, image_length(points))}
+
+/**
+Extent of a sprite above its reference point, in pixels
+*/
+constexpr int sprite_above(const Sprite &sprite)
+{
+    return sprite.originY;
+}
+
+/**
+Extent of a sprite below its reference point, in pixels
+*/
+constexpr int sprite_below(const Sprite &sprite)
+{
+    return sprite.height - 1 - sprite.originY;
+}
+
+/**
+Extent of a sprite to the left of its reference point, in pixels
+*/
+constexpr int sprite_left(const Sprite &sprite)
+{
+    return sprite.originX;
+}
+
+/**
+Extent of a sprite to the right of its reference point, in pixels. A sprite is fully off the
+left of the screen once its reference point is further left than minus this.
+*/
+constexpr int sprite_right(const Sprite &sprite)
+{
+    return sprite.width - 1 - sprite.originX;
+}
+
+#endif
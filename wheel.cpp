@@ -0,0 +1,103 @@
+/**
+@file wheel.cpp
+
+@brief Hashed timing wheel implementation
+
+*/
+
+#include "mbed.h"
+#include "wheel.h"
+
+static void unlink(timing_wheel *w, int t)
+{
+    if (w->prev[t] >= 0) {
+        w->next[w->prev[t]] = w->next[t];
+    } else {
+        w->head[w->due[t] & (WHEEL_SLOTS - 1)] = w->next[t];
+    }
+    if (w->next[t] >= 0) {
+        w->prev[w->next[t]] = w->prev[t];
+    }
+}
+
+void wheel_clear(timing_wheel *w, unsigned int now)
+{
+    w->now = now;
+    memset(w->head, -1, sizeof(w->head));
+    memset(w->pending, 0, sizeof(w->pending));
+}
+
+void wheel_set(timing_wheel *w, int kind, int i, unsigned int due)
+{
+    int t = kind * ENTITY_MAX + i;
+    if (entity_test(w->pending[kind], i)) {
+        unlink(w, t);
+    }
+    if ((int)(due - w->now) <= 0) {
+        due = w->now + 1;
+    }
+    int slot = due & (WHEEL_SLOTS - 1);
+    w->due[t] = due;
+    w->prev[t] = -1;
+    w->next[t] = w->head[slot];
+    if (w->head[slot] >= 0) {
+        w->prev[w->head[slot]] = t;
+    }
+    w->head[slot] = t;
+    entity_set(w->pending[kind], i);
+}
+
+void wheel_cancel(timing_wheel *w, int kind, int i)
+{
+    if (entity_test(w->pending[kind], i)) {
+        unlink(w, kind * ENTITY_MAX + i);
+        entity_reset(w->pending[kind], i);
+    }
+}
+
+void wheel_advance(timing_wheel *w, unsigned int now, uint32_t expired[WHEEL_KINDS][ENTITY_WORDS])
+{
+    memset(expired, 0, sizeof(uint32_t) * WHEEL_KINDS * ENTITY_WORDS);
+    int steps = now - w->now;
+    if (steps > WHEEL_SLOTS) {
+        steps = WHEEL_SLOTS;    // every slot once is enough to find everything that's due
+    }
+    for (int k = 1; k <= steps; k++) {
+        int t = w->head[(w->now + k) & (WHEEL_SLOTS - 1)];
+        while (t >= 0) {
+            int next = w->next[t];
+            if ((int)(w->due[t] - now) <= 0) {
+                unlink(w, t);
+                entity_reset(w->pending[t / ENTITY_MAX], t % ENTITY_MAX);
+                entity_set(expired[t / ENTITY_MAX], t % ENTITY_MAX);
+            }
+            t = next;
+        }
+    }
+    if (steps > 0) {
+        w->now = now;
+    }
+}
+
+int wheel_next(const timing_wheel *w, unsigned int *due)
+{
+    int any = 0;
+    for (int k = 0; k < WHEEL_KINDS; k++) {
+        for (int j = 0; j < ENTITY_WORDS; j++) {
+            any |= w->pending[k][j] != 0;
+        }
+    }
+    if (!any) {
+        return 0;
+    }
+    for (int k = 1; k <= WHEEL_SLOTS; k++) {     // the slots in the order they come round
+        for (int t = w->head[(w->now + k) & (WHEEL_SLOTS - 1)]; t >= 0; t = w->next[t]) {
+            if (w->due[t] == w->now + k) {
+                *due = w->due[t];
+                return 1;
+            }
+        }
+    }
+    *due = w->now + WHEEL_SLOTS;
+    return 1;
+}
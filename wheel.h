@@ -0,0 +1,87 @@
+/**
+@file wheel.h
+@brief Hashed timing wheel holding the enemies' timers in SPACEGAME, a timer of each kind for each enemy.
+@brief A timer is kept in a list for the slot its tick falls in, so advancing the wheel by a tick only visits the
+@brief timers in one slot: the ones that are due, and the few due a whole turn of the wheel or more later.
+@brief Timers that fall due on the same tick are given back together, in order of kind and then enemy,
+@brief however they were added.
+@brief Revision 1.0.
+@author Geoff Grevers
+@date   May 2016
+*/
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdint.h>
+#include "entity.h"
+
+#define WHEEL_SLOTS 64                              /*!< Ticks in one turn of the wheel, a power of two */
+#define WHEEL_SPAWN 0                               /*!< Kind of timer for an enemy coming on screen */
+#define WHEEL_FIRE 1                                /*!< Kind of timer for an enemy firing */
+#define WHEEL_KINDS 2                               /*!< Number of kinds of timer */
+#define WHEEL_TIMERS (WHEEL_KINDS * ENTITY_MAX)     /*!< Number of timers */
+
+#if WHEEL_TIMERS > 32767
+#error "wheel: timers are linked with 16-bit indices"
+#endif
+
+/**
+The wheel, timer t is the enemy t % ENTITY_MAX's timer of kind t / ENTITY_MAX
+@param now - the tick the wheel has been advanced to
+@param head - first timer in each slot, or -1 if it is empty
+@param next - next timer in the same slot, or -1
+@param prev - previous timer in the same slot, or -1 for the first
+@param due - tick each timer is due on
+@param pending - mask of the timers that are set, for each kind
+*/
+struct timing_wheel {
+    unsigned int now;
+    int16_t head[WHEEL_SLOTS];
+    int16_t next[WHEEL_TIMERS];
+    int16_t prev[WHEEL_TIMERS];
+    unsigned int due[WHEEL_TIMERS];
+    uint32_t pending[WHEEL_KINDS][ENTITY_WORDS];
+};
+
+/**
+Clears every timer
+@param w - the wheel
+@param now - the current tick
+*/
+void wheel_clear(timing_wheel *w, unsigned int now);
+
+/**
+Sets a timer, or moves it if it was already set
+@param w - the wheel
+@param kind - WHEEL_SPAWN or WHEEL_FIRE
+@param i - the enemy
+@param due - tick it is due on, a tick that has passed means the next one
+*/
+void wheel_set(timing_wheel *w, int kind, int i, unsigned int due);
+
+/**
+Clears a timer if it is set
+@param w - the wheel
+@param kind - WHEEL_SPAWN or WHEEL_FIRE
+@param i - the enemy
+*/
+void wheel_cancel(timing_wheel *w, int kind, int i);
+
+/**
+Advances the wheel and takes out the timers that have fallen due
+@param w - the wheel
+@param now - the current tick
+@param expired - masks to fill with the timers that fell due, for each kind, walk them with entity_find()
+*/
+void wheel_advance(timing_wheel *w, unsigned int now, uint32_t expired[WHEEL_KINDS][ENTITY_WORDS]);
+
+/**
+Finds the tick the next timer is due on, so that the scheduler can take that tick
+@param w - the wheel
+@param due - set to the tick, or to a turn of the wheel from now if every timer is further off than that
+@returns 1 if any timer is set, 0 if none is
+*/
+int wheel_next(const timing_wheel *w, unsigned int *due);
+
+#endif